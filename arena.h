@@ -0,0 +1,103 @@
+#ifndef __TAB_ARENA_H
+#define __TAB_ARENA_H
+
+namespace obj {
+
+/*
+ * Bump allocator for objects owned by a single container.
+ *
+ * Memory is handed out from large blocks and is never freed one object at
+ * a time: 'reset()' drops everything at once. Objects placed in an arena
+ * must be destroyed explicitly (not deleted) before the arena is reset.
+ * The largest block is kept across resets, so a container that is filled
+ * over and over does not go back to the system allocator.
+ */
+
+struct Arena {
+
+    static const size_t ALIGN = 16;
+    static const size_t BLOCK = 64 * 1024;
+
+    std::vector<char*> blocks;
+    char* pos;
+    char* end;
+    size_t next;
+    size_t total;
+
+    Arena() : pos(nullptr), end(nullptr), next(BLOCK), total(0) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        for (char* b : blocks) {
+            ::free(b);
+        }
+    }
+
+    void* alloc(size_t n, size_t align) {
+
+        char* p = (char*)(((uintptr_t)pos + align - 1) & ~(uintptr_t)(align - 1));
+
+        if (pos == nullptr || p + n > end) {
+            grow(n);
+            p = pos;
+        }
+
+        pos = p + n;
+        return p;
+    }
+
+    // Bytes taken from the system allocator.
+    size_t size() const {
+        return total;
+    }
+
+    template <typename T, typename... A>
+    T* make(A&&... a) {
+        return new (alloc(sizeof(T), alignof(T))) T(std::forward<A>(a)...);
+    }
+
+    void reset() {
+
+        if (blocks.empty())
+            return;
+
+        for (size_t i = 0; i + 1 < blocks.size(); ++i) {
+            ::free(blocks[i]);
+        }
+
+        char* last = blocks.back();
+
+        blocks.clear();
+        blocks.push_back(last);
+
+        pos = last;
+        end = last + next / 2;
+        total = next / 2;
+    }
+
+private:
+
+    void grow(size_t n) {
+
+        size_t size = std::max(next, n);
+        void* b = nullptr;
+
+        if (::posix_memalign(&b, ALIGN, size) != 0)
+            throw std::bad_alloc();
+
+        blocks.push_back((char*)b);
+        total += size;
+
+        pos = (char*)b;
+        end = pos + size;
+
+        // Blocks double in size, so a map with N entries takes O(log N) of them.
+        next = size * 2;
+    }
+};
+
+}
+
+#endif
@@ -45,9 +45,20 @@ struct Command {
         MAP,
         FUN,
         FUN0,
+        FUN2,
+        FUN3,
         SEQ,
         TUP,
-        GEN
+        GEN,
+
+        IF,
+        LAND,
+        LOR,
+
+        JMP,
+        JZ,
+        JNZ,
+        BOOL
     };
 
     cmd_t cmd;
@@ -69,6 +80,67 @@ struct Command {
     template <typename T>
     Command(cmd_t c, const T& t) : cmd(c), arg(t), object(nullptr), function(nullptr) {}
 
+    // Number of values taken from and put on the stack by a (lowered) instruction.
+    int pops() const {
+
+        switch (cmd) {
+        case VAL:
+        case VAR:
+        case FUN0:
+        case JMP:
+            return 0;
+
+        case FUN2:
+        case EQ:
+        case LT:
+        case ROT:
+        case EXP:
+        case MUL_I:
+        case MUL_R:
+        case DIV_I:
+        case DIV_R:
+        case MOD:
+        case ADD_I:
+        case ADD_R:
+        case SUB_I:
+        case SUB_R:
+        case AND:
+        case OR:
+        case XOR:
+        case I2R_2:
+        case U2R_2:
+            return 2;
+
+        case FUN3:
+            return 3;
+
+        case TUP:
+            return (int)arg.uint;
+
+        default:
+            return 1;
+        }
+    }
+
+    int pushes() const {
+
+        switch (cmd) {
+        case VAW:
+        case JMP:
+        case JZ:
+        case JNZ:
+            return 0;
+
+        case ROT:
+        case I2R_2:
+        case U2R_2:
+            return 2;
+
+        default:
+            return 1;
+        }
+    }
+
     static std::string print(cmd_t c) {
         switch (c) {
         case VAL: return "VAL";
@@ -105,9 +177,20 @@ struct Command {
         case MAP: return "MAP";
         case FUN: return "FUN";
         case FUN0: return "FUN0";
+        case FUN2: return "FUN2";
+        case FUN3: return "FUN3";
         case SEQ: return "SEQ";
         case TUP: return "TUP";
         case GEN: return "GEN";
+
+        case IF: return "IF";
+        case LAND: return "LAND";
+        case LOR: return "LOR";
+
+        case JMP: return "JMP";
+        case JZ: return "JZ";
+        case JNZ: return "JNZ";
+        case BOOL: return "BOOL";
         }
         return ":~(";
     }
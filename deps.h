@@ -2,6 +2,9 @@
 #define __TAB_DEPS_H
 
 #include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <memory>
 #include <stdexcept>
@@ -11,6 +14,7 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <map>
+#include <queue>
 #include <initializer_list>
 #include <utility>
 #include <algorithm>
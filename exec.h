@@ -50,10 +50,15 @@ void execute_init(std::vector<Command>& commands) {
         case Command::SEQ:
         case Command::ROT:
         case Command::VAW:
+        case Command::JMP:
+        case Command::JZ:
+        case Command::JNZ:
             break;
 
         case Command::FUN:
         case Command::FUN0:
+        case Command::FUN2:
+        case Command::FUN3:
             if (c.object == nullptr)
                 c.object = obj::make(c.type);
             break;
@@ -72,7 +77,9 @@ void execute_init(std::vector<Command>& commands) {
 
 void execute_run(std::vector<Command>& commands, Runtime& r) {
     
-    for (Command& c : commands) {
+    for (size_t ip = 0; ip < commands.size(); ++ip) {
+        Command& c = commands[ip];
+
         switch (c.cmd) {
 
         case Command::FUN:
@@ -91,6 +98,32 @@ void execute_run(std::vector<Command>& commands, Runtime& r) {
             r.stack.push_back(c.object);
             break;
         }
+        case Command::FUN2:
+        {
+            obj::Object* b = r.stack.back();
+            r.stack.pop_back();
+            obj::Object* a = r.stack.back();
+            r.stack.pop_back();
+
+            ((Functions::func2_t)c.function)(a, b, c.object);
+
+            r.stack.push_back(c.object);
+            break;
+        }
+        case Command::FUN3:
+        {
+            obj::Object* x = r.stack.back();
+            r.stack.pop_back();
+            obj::Object* b = r.stack.back();
+            r.stack.pop_back();
+            obj::Object* a = r.stack.back();
+            r.stack.pop_back();
+
+            ((Functions::func3_t)c.function)(a, b, x, c.object);
+
+            r.stack.push_back(c.object);
+            break;
+        }
         case Command::VAR:
         {
             r.stack.push_back(r.get_var(c.arg.uint));
@@ -219,6 +252,42 @@ void execute_run(std::vector<Command>& commands, Runtime& r) {
             r.stack.push_back(b);
             break;
         }
+
+        case Command::JMP:
+        {
+            ip += c.arg.uint;
+            break;
+        }
+
+        case Command::JZ:
+        {
+            obj::Int& x = obj::get<obj::Int>(r.stack.back());
+            r.stack.pop_back();
+
+            if (x.v == 0)
+                ip += c.arg.uint;
+            break;
+        }
+
+        case Command::JNZ:
+        {
+            obj::Int& x = obj::get<obj::Int>(r.stack.back());
+            r.stack.pop_back();
+
+            if (x.v != 0)
+                ip += c.arg.uint;
+            break;
+        }
+
+        case Command::BOOL:
+        {
+            obj::Int& a = obj::get<obj::Int>(r.stack.back());
+            r.stack.pop_back();
+            obj::UInt& x = obj::get<obj::UInt>(c.object);
+            x.v = (a.v != 0 ? 1 : 0);
+            r.stack.push_back(c.object);
+            break;
+        }
         
         // And here comes the numeric operator boilerplate.
 
@@ -352,6 +421,11 @@ void execute_run(std::vector<Command>& commands, Runtime& r) {
             break;
         }
 
+        case Command::IF:
+        case Command::LAND:
+        case Command::LOR:
+            throw std::runtime_error("Sanity error: executing unlowered conditional.");
+
         }
     }
 }
@@ -364,6 +438,11 @@ void execute(std::vector<Command>& commands, const Type& type, size_t nvars, std
     rt.set_var(0, toplevel);
 
     execute_init(commands);
+
+    // A map or a sort printed as the result can spill to disk when it outgrows the memory budget.
+    if (!commands.empty())
+        obj::spill_target() = commands.back().object;
+
     execute_run(commands, rt);
 
     obj::Object* res;
@@ -0,0 +1,314 @@
+#ifndef __TAB_FLATMAP_H
+#define __TAB_FLATMAP_H
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace obj {
+
+/*
+ * Open-addressing hash table used for all maps.
+ *
+ * Entries are stored densely in insertion order, which is also the order
+ * of iteration. The hash table itself is an array of control bytes and an
+ * array of entry indexes: a control byte is either 'empty' or holds 7 bits
+ * of the entry's hash. Lookups scan groups of 16 control bytes at once
+ * (with SSE2 when available) and only compare keys whose hash bits match.
+ * Full hashes are cached, so growing the table never rehashes a key.
+ * The hash function must be well mixed in all bits (see hash.h).
+ *
+ * Entries are never erased, only cleared all at once. Growing the table
+ * moves entries, so pointers into it are only stable while nothing is
+ * inserted.
+ */
+
+template <typename K, typename V, typename Hash, typename Eq>
+struct FlatMap {
+
+    typedef std::pair<K, V> value_type;
+    typedef value_type* iterator;
+    typedef value_type* const_iterator;
+
+    static const size_t GROUP = 16;
+    static const signed char EMPTY = -128;
+
+    struct Group {
+
+        const signed char* ctrl;
+
+        Group(const signed char* c) : ctrl(c) {}
+
+#ifdef __SSE2__
+        unsigned int match(signed char h) const {
+            __m128i c = _mm_load_si128((const __m128i*)ctrl);
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8(h)));
+        }
+#else
+        unsigned int match(signed char h) const {
+            unsigned int ret = 0;
+            for (size_t i = 0; i < GROUP; ++i) {
+                if (ctrl[i] == h)
+                    ret |= (1u << i);
+            }
+            return ret;
+        }
+#endif
+
+        unsigned int empty() const {
+            return match(EMPTY);
+        }
+    };
+
+    // The entries, in insertion order.
+    value_type* entries;
+    size_t* hashes;
+    size_t count;
+    size_t room;
+
+    // The hash table.
+    signed char* ctrl;
+    uint32_t* index;
+    size_t cap;
+
+    Hash hasher;
+    Eq equal;
+
+    FlatMap() : entries(nullptr), hashes(nullptr), count(0), room(0),
+                ctrl(nullptr), index(nullptr), cap(0) {}
+
+    FlatMap(const FlatMap&) = delete;
+    FlatMap& operator=(const FlatMap&) = delete;
+
+    ~FlatMap() {
+        clear();
+        ::operator delete((void*)entries);
+        delete [] hashes;
+        ::free(ctrl);
+        delete [] index;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Memory held by the entries and the table.
+    size_t bytes() const {
+        return room * (sizeof(value_type) + sizeof(size_t)) + cap * (1 + sizeof(uint32_t));
+    }
+
+    iterator begin() const { return entries; }
+    iterator end() const { return entries + count; }
+
+    static signed char tag(size_t h) {
+        return (signed char)(h & 0x7f);
+    }
+
+    // The probe sequence for hash 'h' visits groups g, g+1, g+3, g+6, ...
+    size_t first_group(size_t h) const {
+        return ((h >> 7) & (cap / GROUP - 1));
+    }
+
+    size_t next_group(size_t g, size_t step) const {
+        return ((g + step) & (cap / GROUP - 1));
+    }
+
+    value_type* find(const K& k) const {
+
+        if (count == 0)
+            return nullptr;
+
+        size_t h = hasher(k);
+        signed char t = tag(h);
+        size_t g = first_group(h);
+
+        for (size_t step = 1; ; ++step) {
+
+            Group grp(ctrl + g * GROUP);
+            unsigned int m = grp.match(t);
+
+            while (m) {
+                value_type& e = entries[index[g * GROUP + __builtin_ctz(m)]];
+
+                if (equal(e.first, k))
+                    return &e;
+
+                m &= m - 1;
+            }
+
+            if (grp.empty())
+                return nullptr;
+
+            g = next_group(g, step);
+        }
+    }
+
+    // Finds the entry for 'k' in a single probe; if there is none, appends
+    // one with the key made by 'make_key()' and a default value.
+    template <typename F>
+    std::pair<value_type*, bool> find_or_insert(const K& k, F make_key) {
+
+        if ((count + 1) * 8 > cap * 7)
+            rehash(cap == 0 ? GROUP : cap * 2);
+
+        size_t h = hasher(k);
+        signed char t = tag(h);
+        size_t g = first_group(h);
+
+        for (size_t step = 1; ; ++step) {
+
+            Group grp(ctrl + g * GROUP);
+            unsigned int m = grp.match(t);
+
+            while (m) {
+                value_type& e = entries[index[g * GROUP + __builtin_ctz(m)]];
+
+                if (equal(e.first, k))
+                    return std::make_pair(&e, false);
+
+                m &= m - 1;
+            }
+
+            unsigned int em = grp.empty();
+
+            if (em) {
+
+                if (count == room)
+                    reserve(room == 0 ? GROUP : room * 2);
+
+                size_t i = g * GROUP + __builtin_ctz(em);
+                value_type* e = new (&entries[count]) value_type(make_key(), V());
+
+                ctrl[i] = t;
+                index[i] = (uint32_t)count;
+                hashes[count] = h;
+                ++count;
+
+                return std::make_pair(e, true);
+            }
+
+            g = next_group(g, step);
+        }
+    }
+
+    std::pair<value_type*, bool> emplace(const K& k, const V& v) {
+
+        auto ret = find_or_insert(k, [&k]() { return k; });
+
+        if (ret.second)
+            ret.first->second = v;
+
+        return ret;
+    }
+
+    void clear() {
+
+        for (size_t i = 0; i < count; ++i) {
+            entries[i].~value_type();
+        }
+
+        if (cap > 0)
+            ::memset(ctrl, EMPTY, cap);
+
+        count = 0;
+    }
+
+    // Reorders the entries by key, so that they are iterated in sorted order.
+    template <typename Less>
+    void sort(Less less) {
+
+        if (count == 0)
+            return;
+
+        std::vector<uint32_t> order(count);
+
+        for (size_t i = 0; i < count; ++i) {
+            order[i] = (uint32_t)i;
+        }
+
+        std::sort(order.begin(), order.end(), [this, &less](uint32_t a, uint32_t b) {
+                return less(entries[a].first, entries[b].first);
+            });
+
+        value_type* e = (value_type*)::operator new(room * sizeof(value_type));
+        size_t* h = new size_t[room];
+
+        for (size_t i = 0; i < count; ++i) {
+            new (&e[i]) value_type(std::move(entries[order[i]]));
+            h[i] = hashes[order[i]];
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            entries[i].~value_type();
+        }
+
+        ::operator delete((void*)entries);
+        delete [] hashes;
+
+        entries = e;
+        hashes = h;
+
+        rehash(cap);
+    }
+
+private:
+
+    void reserve(size_t n) {
+
+        value_type* e = (value_type*)::operator new(n * sizeof(value_type));
+        size_t* h = new size_t[n];
+
+        for (size_t i = 0; i < count; ++i) {
+            new (&e[i]) value_type(std::move(entries[i]));
+            entries[i].~value_type();
+            h[i] = hashes[i];
+        }
+
+        ::operator delete((void*)entries);
+        delete [] hashes;
+
+        entries = e;
+        hashes = h;
+        room = n;
+    }
+
+    void rehash(size_t n) {
+
+        void* c = nullptr;
+
+        if (::posix_memalign(&c, GROUP, n) != 0)
+            throw std::bad_alloc();
+
+        ::free(ctrl);
+        delete [] index;
+
+        ctrl = (signed char*)c;
+        index = new uint32_t[n];
+        cap = n;
+
+        ::memset(ctrl, EMPTY, n);
+
+        for (size_t j = 0; j < count; ++j) {
+
+            size_t h = hashes[j];
+            size_t g = first_group(h);
+
+            for (size_t step = 1; ; ++step) {
+
+                unsigned int em = Group(ctrl + g * GROUP).empty();
+
+                if (em) {
+                    size_t i = g * GROUP + __builtin_ctz(em);
+                    ctrl[i] = tag(h);
+                    index[i] = (uint32_t)j;
+                    break;
+                }
+
+                g = next_group(g, step);
+            }
+        }
+    }
+};
+
+}
+
+#endif
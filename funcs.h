@@ -12,6 +12,7 @@ namespace funcs {
 #include "funcs/cutgrep.h"
 #include "funcs/zip.h"
 #include "funcs/file.h"
+#include "funcs/pushdown.h"
 #include "funcs/sum.h"
 #include "funcs/minmax.h"
 #include "funcs/avg.h"
@@ -20,6 +21,10 @@ namespace funcs {
 #include "funcs/sort.h"
 #include "funcs/misc.h"
 #include "funcs/hist.h"
+#include "funcs/group.h"
+#include "funcs/top.h"
+#include "funcs/distinct.h"
+#include "funcs/quantile.h"
 
 }
 
@@ -37,6 +42,7 @@ void register_functions() {
     funcs::register_head(funs);
     funcs::register_cutgrep(funs);
     funcs::register_zip(funs);
+    funcs::register_pushdown(funs);
     funcs::register_sum(funs);
     funcs::register_minmax(funs);
     funcs::register_avg(funs);
@@ -45,6 +51,10 @@ void register_functions() {
     funcs::register_sort(funs);
     funcs::register_misc(funs);
     funcs::register_hist(funs);
+    funcs::register_group(funs);
+    funcs::register_top(funs);
+    funcs::register_distinct(funs);
+    funcs::register_quantile(funs);
 }
 
 #endif
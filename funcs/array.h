@@ -20,6 +20,7 @@ struct AtomArrayObject : public obj::ArrayObject {
 
     obj::Object* clone() const {
         AtomArrayObject* ret = new AtomArrayObject;
+        ret->v.reserve(v.size());
 
         for (const Object* s : v) {
             ret->v.push_back(s->clone());
@@ -51,28 +52,75 @@ void array_from_tuple(const obj::Object* in, obj::Object*& out) {
     y.v.push_back((obj::Object*)in);
 }
 
-void array_from_map(const obj::Object* in, obj::Object*& out) {
+/*
+ * An array of (key, value) pairs that point into a map.
+ *
+ * The pair tuples do not own their elements. They are kept across calls,
+ * so converting a map to an array over and over does not allocate once
+ * the array has reached its largest size.
+ */
 
-    obj::MapObject& a = obj::get<obj::MapObject>(in);
-    obj::ArrayObject& o = obj::get<obj::ArrayObject>(out);
-    
-    typename obj::MapObject::map_t::const_iterator b = a.v.begin();
-    typename obj::MapObject::map_t::const_iterator e = a.v.end();
+struct MapPairs : public obj::ArrayObject {
 
-    o.v.clear();
-    
-    while (b != e) {
+    std::vector<obj::Object*> spare;
 
-        obj::Tuple* tmp = new obj::Tuple;
-        tmp->v.resize(2);
-        tmp->v[0] = b->first;
-        tmp->v[1] = b->second;
+    ~MapPairs() {
 
-        o.v.push_back(tmp);
-        
-        ++b;
+        resize(0);
+
+        for (obj::Object* t : spare) {
+            obj::get<obj::Tuple>(t).v.clear();
+            delete t;
+        }
     }
-}
+
+    void resize(size_t n) {
+
+        while (v.size() > n) {
+            spare.push_back(v.back());
+            v.pop_back();
+        }
+
+        while (v.size() < n) {
+
+            if (spare.empty()) {
+                obj::Tuple* t = new obj::Tuple;
+                t->v.resize(2);
+                v.push_back(t);
+
+            } else {
+                v.push_back(spare.back());
+                spare.pop_back();
+            }
+        }
+    }
+
+    void set(size_t i, obj::Object* key, obj::Object* val) {
+
+        obj::Tuple& t = obj::get<obj::Tuple>(v[i]);
+        t.v[0] = key;
+        t.v[1] = val;
+    }
+};
+
+template <typename M>
+struct array_from_map {
+
+    static void doit(const obj::Object* in, obj::Object*& out) {
+
+        M& a = obj::get<M>(in);
+        MapPairs& o = obj::get<MapPairs>(out);
+
+        o.resize(a.v.size());
+
+        size_t i = 0;
+
+        for (const auto& x : a.v) {
+            o.set(i, M::key(x), x.second);
+            ++i;
+        }
+    }
+};
 
 void array_from_seq(const obj::Object* in, obj::Object*& out) {
 
@@ -97,7 +145,9 @@ Functions::func_t array_checker(const Type& args, Type& ret, obj::Object*& obj)
 
         ret.push(pair);
 
-        return array_from_map;
+        obj = new MapPairs;
+
+        return obj::map_pick<Functions::func_t,array_from_map>(args.tuple->at(0));
 
     } else if (args.type == Type::SEQ) {
 
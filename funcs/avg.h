@@ -12,6 +12,12 @@ struct AtomAvg : public obj::Real {
         ret->v = v;
         return ret;
     }
+
+    obj::Object* clone_in(obj::Arena& a) const {
+        AtomAvg* ret = a.make<AtomAvg>();
+        ret->v = v;
+        return ret;
+    }
     
     void merge(const obj::Object* o) {
         v += obj::get<obj::Real>(o).v;
@@ -38,6 +44,12 @@ struct AtomVar : public obj::Real {
         return ret;
     }
 
+    obj::Object* clone_in(obj::Arena& a) const {
+        AtomVar* ret = a.make<AtomVar>();
+        ret->v = v;
+        return ret;
+    }
+
     void merge_start() {
         K = v;
         v = 0;
@@ -64,6 +76,12 @@ struct AtomStdev : public AtomVar {
         return ret;
     }
 
+    obj::Object* clone_in(obj::Arena& a) const {
+        AtomStdev* ret = a.make<AtomStdev>();
+        ret->v = v;
+        return ret;
+    }
+
     void merge_end() {
         AtomVar::merge_end();
         v = ::sqrt(v);
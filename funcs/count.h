@@ -33,13 +33,17 @@ void count_arr(const obj::Object* in, obj::Object*& out) {
     i = arr.v.size();
 }
 
-void count_map(const obj::Object* in, obj::Object*& out) {
+template <typename M>
+struct count_map {
 
-    const auto& map = obj::get<obj::MapObject>(in);
-    UInt& i = obj::get<obj::UInt>(out).v;
+    static void doit(const obj::Object* in, obj::Object*& out) {
 
-    i = map.v.size();
-}
+        const auto& map = obj::get<M>(in);
+        UInt& i = obj::get<obj::UInt>(out).v;
+
+        i = map.v.size();
+    }
+};
 
 struct CountNull : public obj::SeqBase {
 
@@ -89,10 +93,16 @@ Functions::func_t count_checker(const Type& args, Type& ret, obj::Object*& obj)
         return count_seq;
 
     case Type::MAP:
-        return count_map;
+        return obj::map_pick<Functions::func_t,count_map>(args.tuple->at(0));
 
     case Type::ARR:
-        switch (args.tuple->at(0).type) {
+    {
+        const Type& t = args.tuple->at(0);
+
+        if (t.type != Type::ATOM)
+            return count_arr;
+
+        switch (t.atom) {
         case Type::INT:
             return count_arratom<Int>;
         case Type::UINT:
@@ -101,9 +111,9 @@ Functions::func_t count_checker(const Type& args, Type& ret, obj::Object*& obj)
             return count_arratom<Real>;
         case Type::STRING:
             return count_arratom<std::string>;
-        default:
-            return count_arr;
         }
+        return nullptr;
+    }
 
     case Type::ATOM:
         if (args.atom == Type::STRING) {
@@ -117,9 +127,40 @@ Functions::func_t count_checker(const Type& args, Type& ret, obj::Object*& obj)
 }
 
 
+// Counting a sequence never looks at its elements, so the code that computes
+// them (apart from filter flags) is dead.
+bool count_rewriter(Command& c, std::vector<Command>& code) {
+
+    if (c.function != (void*)count_seq || code.empty())
+        return false;
+
+    Command& last = code.back();
+
+    if (last.cmd == Command::GEN) {
+
+        kill_element(last.closure[0]->code);
+
+    } else if (last.cmd == Command::FUN && last.function == (void*)filter &&
+               code.size() >= 2 && code[code.size()-2].cmd == Command::GEN) {
+
+        std::vector<Command>& elt = code[code.size()-2].closure[0]->code;
+
+        if (elt.empty() || elt.back().cmd != Command::TUP)
+            return false;
+
+        std::vector<bool> live(elt.back().arg.uint, false);
+        live[0] = true;
+
+        kill_tuple_parts(elt, live);
+    }
+
+    return false;
+}
+
 void register_count(Functions& funcs) {
 
     funcs.add_poly("count", count_checker);
+    funcs.add_rewriter("count", count_rewriter);
 }
 
 #endif
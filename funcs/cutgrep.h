@@ -1,12 +1,37 @@
 #ifndef __TUP_FUNCS_CUTGREP_H
 #define __TUP_FUNCS_CUTGREP_H
 
-void cut(const obj::Object* in, obj::Object*& out) {
+// Fills an array of strings in place. The strings already in the array are
+// overwritten rather than destroyed, so when a line is split into the same
+// number of fields as the one before, no memory is allocated.
+struct StringFill {
 
-    obj::Tuple& args = obj::get<obj::Tuple>(in);
-    
-    const std::string& str = obj::get<obj::String>(args.v[0]).v;
-    const std::string& del = obj::get<obj::String>(args.v[1]).v;
+    std::vector<std::string>& v;
+    size_t n;
+
+    StringFill(std::vector<std::string>& x) : v(x), n(0) {}
+
+    template <typename I>
+    void add(I b, I e) {
+
+        if (n < v.size()) {
+            v[n].assign(b, e);
+        } else {
+            v.emplace_back(b, e);
+        }
+
+        ++n;
+    }
+
+    void done() {
+        v.resize(n);
+    }
+};
+
+void cut_2(const obj::Object* a0, const obj::Object* a1, obj::Object*& out) {
+
+    const std::string& str = obj::get<obj::String>(a0).v;
+    const std::string& del = obj::get<obj::String>(a1).v;
 
     size_t N = str.size();
     size_t M = del.size();
@@ -14,9 +39,7 @@ void cut(const obj::Object* in, obj::Object*& out) {
     size_t prev = 0;
 
     obj::ArrayAtom<std::string>& vv = obj::get< obj::ArrayAtom<std::string> >(out);
-    std::vector<std::string>& v = vv.v;
-    
-    v.clear();
+    StringFill v(vv.v);
     
     for (size_t i = 0; i < N; ++i) {
 
@@ -32,23 +55,28 @@ void cut(const obj::Object* in, obj::Object*& out) {
         }
 
         if (matched) {
-            v.emplace_back(str.begin() + prev, str.begin() + i);
+            v.add(str.begin() + prev, str.begin() + i);
             i += M;
             prev = i;
             --i;
         }
     }
 
-    v.emplace_back(str.begin() + prev, str.end());
+    v.add(str.begin() + prev, str.end());
+    v.done();
 }
 
-void cutn(const obj::Object* in, obj::Object*& out) {
+void cut(const obj::Object* in, obj::Object*& out) {
 
     obj::Tuple& args = obj::get<obj::Tuple>(in);
-    
-    const std::string& str = obj::get<obj::String>(args.v[0]).v;
-    const std::string& del = obj::get<obj::String>(args.v[1]).v;
-    UInt nth = obj::get<obj::UInt>(args.v[2]).v;
+    cut_2(args.v[0], args.v[1], out);
+}
+
+void cutn_3(const obj::Object* a0, const obj::Object* a1, const obj::Object* a2, obj::Object*& out) {
+
+    const std::string& str = obj::get<obj::String>(a0).v;
+    const std::string& del = obj::get<obj::String>(a1).v;
+    UInt nth = obj::get<obj::UInt>(a2).v;
     
     size_t N = str.size();
     size_t M = del.size();
@@ -96,6 +124,12 @@ void cutn(const obj::Object* in, obj::Object*& out) {
     throw std::runtime_error("Substring not found in 'cut'");
 }
 
+void cutn(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    cutn_3(args.v[0], args.v[1], args.v[2], out);
+}
+
 
 struct RegexCache {
 
@@ -118,17 +152,13 @@ const std::regex& regex_cache(const std::string& s) {
     return cache.get(s);
 }
 
-void grep(const obj::Object* in, obj::Object*& out) {
+void grep_2(const obj::Object* a0, const obj::Object* a1, obj::Object*& out) {
 
-    obj::Tuple& args = obj::get<obj::Tuple>(in);
-    
-    const std::string& str = obj::get<obj::String>(args.v[0]).v;
-    const std::string& regex = obj::get<obj::String>(args.v[1]).v;
+    const std::string& str = obj::get<obj::String>(a0).v;
+    const std::string& regex = obj::get<obj::String>(a1).v;
 
     obj::ArrayAtom<std::string>& vv = obj::get< obj::ArrayAtom<std::string> >(out);
-    std::vector<std::string>& v = vv.v;
-
-    v.clear();
+    StringFill v(vv.v);
 
     const std::regex& r = regex_cache(regex);
 
@@ -139,7 +169,7 @@ void grep(const obj::Object* in, obj::Object*& out) {
 
         if (iter->size() == 1) {
 
-            v.emplace_back(iter->str());
+            v.add((*iter)[0].first, (*iter)[0].second);
 
         } else if (iter->size() > 1) {
             auto subi = iter->begin();
@@ -147,21 +177,27 @@ void grep(const obj::Object* in, obj::Object*& out) {
             ++subi;
             
             while (subi != sube) {
-                v.emplace_back(subi->str());
+                v.add(subi->first, subi->second);
                 ++subi;
             }
         }
 
         ++iter;
     }
+
+    v.done();
 }
 
-void grepif(const obj::Object* in, obj::Object*& out) {
+void grep(const obj::Object* in, obj::Object*& out) {
 
     obj::Tuple& args = obj::get<obj::Tuple>(in);
-    
-    const std::string& str = obj::get<obj::String>(args.v[0]).v;
-    const std::string& regex = obj::get<obj::String>(args.v[1]).v;
+    grep_2(args.v[0], args.v[1], out);
+}
+
+void grepif_2(const obj::Object* a0, const obj::Object* a1, obj::Object*& out) {
+
+    const std::string& str = obj::get<obj::String>(a0).v;
+    const std::string& regex = obj::get<obj::String>(a1).v;
 
     obj::UInt& res = obj::get<obj::UInt>(out);
 
@@ -172,13 +208,17 @@ void grepif(const obj::Object* in, obj::Object*& out) {
     res.v = (found ? 1 : 0);
 }
 
-void replace(const obj::Object* in, obj::Object*& out) {
+void grepif(const obj::Object* in, obj::Object*& out) {
 
     obj::Tuple& args = obj::get<obj::Tuple>(in);
-    
-    const std::string& str = obj::get<obj::String>(args.v[0]).v;
-    const std::string& regex = obj::get<obj::String>(args.v[1]).v;
-    const std::string& rep = obj::get<obj::String>(args.v[2]).v;
+    grepif_2(args.v[0], args.v[1], out);
+}
+
+void replace_3(const obj::Object* a0, const obj::Object* a1, const obj::Object* a2, obj::Object*& out) {
+
+    const std::string& str = obj::get<obj::String>(a0).v;
+    const std::string& regex = obj::get<obj::String>(a1).v;
+    const std::string& rep = obj::get<obj::String>(a2).v;
     
     std::string& res = obj::get<obj::String>(out).v;
 
@@ -189,17 +229,19 @@ void replace(const obj::Object* in, obj::Object*& out) {
     std::regex_replace(std::back_insert_iterator<std::string>(res), str.begin(), str.end(), r, rep);
 }
 
-void recut(const obj::Object* in, obj::Object*& out) {
+void replace(const obj::Object* in, obj::Object*& out) {
 
     obj::Tuple& args = obj::get<obj::Tuple>(in);
+    replace_3(args.v[0], args.v[1], args.v[2], out);
+}
 
-    const std::string& str = obj::get<obj::String>(args.v[0]).v;
-    const std::string& regex = obj::get<obj::String>(args.v[1]).v;
+void recut_2(const obj::Object* a0, const obj::Object* a1, obj::Object*& out) {
 
-    obj::ArrayAtom<std::string>& vv = obj::get< obj::ArrayAtom<std::string> >(out);
-    std::vector<std::string>& v = vv.v;
+    const std::string& str = obj::get<obj::String>(a0).v;
+    const std::string& regex = obj::get<obj::String>(a1).v;
 
-    v.clear();
+    obj::ArrayAtom<std::string>& vv = obj::get< obj::ArrayAtom<std::string> >(out);
+    StringFill v(vv.v);
 
     const std::regex& r = regex_cache(regex);
 
@@ -210,11 +252,11 @@ void recut(const obj::Object* in, obj::Object*& out) {
     while (1) {
 
         if (!std::regex_search(iter, end, match, r)) {
-            v.emplace_back(iter, end);
+            v.add(iter, end);
             break;
         }
 
-        v.emplace_back(iter, match[0].first);
+        v.add(iter, match[0].first);
 
         if (iter == match[0].second)
             throw std::runtime_error("Cannot use an empty match as a delimiter in 'recut'.");
@@ -222,19 +264,25 @@ void recut(const obj::Object* in, obj::Object*& out) {
         iter = match[0].second;
 
         if (iter == end) {
-            v.emplace_back();
+            v.add(end, end);
             break;
         }
     }
+
+    v.done();
 }
 
-void recutn(const obj::Object* in, obj::Object*& out) {
+void recut(const obj::Object* in, obj::Object*& out) {
 
     obj::Tuple& args = obj::get<obj::Tuple>(in);
+    recut_2(args.v[0], args.v[1], out);
+}
+
+void recutn_3(const obj::Object* a0, const obj::Object* a1, const obj::Object* a2, obj::Object*& out) {
 
-    const std::string& str = obj::get<obj::String>(args.v[0]).v;
-    const std::string& regex = obj::get<obj::String>(args.v[1]).v;
-    UInt nth = obj::get<obj::UInt>(args.v[2]).v;
+    const std::string& str = obj::get<obj::String>(a0).v;
+    const std::string& regex = obj::get<obj::String>(a1).v;
+    UInt nth = obj::get<obj::UInt>(a2).v;
     
     std::string& v = obj::get<obj::String>(out).v;
     v.clear();
@@ -273,6 +321,149 @@ void recutn(const obj::Object* in, obj::Object*& out) {
     throw std::runtime_error("Substring not found in 'recut'");
 }
 
+void recutn(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    recutn_3(args.v[0], args.v[1], args.v[2], out);
+}
+
+/*
+ * Chains of 'cut' and 'recut' with literal delimiters and indexes, like
+ * cut(cut(@," ",2),"?",0), are fused into one call that narrows a single
+ * range of the input string step by step and copies out only the final field.
+ */
+
+struct CutChain : public obj::String {
+
+    struct step_t {
+        std::string del;
+        const std::regex* regex;
+        UInt nth;
+    };
+
+    std::vector<step_t> steps;
+};
+
+const char* cut_chain_find(const char* b, const char* e, const std::string& del) {
+
+    if (del.size() == 1) {
+        const char* ret = (const char*)::memchr(b, del[0], e - b);
+        return (ret ? ret : e);
+    }
+
+    return std::search(b, e, del.begin(), del.end());
+}
+
+void cut_chain_literal(const char*& b, const char*& e, const CutChain::step_t& step) {
+
+    size_t M = step.del.size();
+
+    for (UInt i = 0; i < step.nth; ++i) {
+
+        const char* d = cut_chain_find(b, e, step.del);
+
+        if (d == e)
+            throw std::runtime_error("Substring not found in 'cut'");
+
+        b = d + M;
+    }
+
+    e = cut_chain_find(b, e, step.del);
+}
+
+void cut_chain_regex(const char*& b, const char*& e, const CutChain::step_t& step) {
+
+    UInt nmatch = 0;
+    std::cmatch match;
+
+    while (b != e) {
+
+        if (!std::regex_search(b, e, match, *step.regex)) {
+            break;
+        }
+
+        if (b == match[0].second)
+            throw std::runtime_error("Cannot use an empty match as a delimiter in 'recut'.");
+
+        if (nmatch == step.nth) {
+            e = match[0].first;
+            return;
+        }
+
+        b = match[0].second;
+        ++nmatch;
+    }
+
+    if (nmatch != step.nth)
+        throw std::runtime_error("Substring not found in 'recut'");
+}
+
+void cut_chain(const obj::Object* in, obj::Object*& out) {
+
+    const std::string& str = obj::get<obj::String>(in).v;
+    CutChain& chain = obj::get<CutChain>(out);
+
+    const char* b = str.data();
+    const char* e = b + str.size();
+
+    for (const CutChain::step_t& step : chain.steps) {
+
+        if (step.regex) {
+            cut_chain_regex(b, e, step);
+        } else {
+            cut_chain_literal(b, e, step);
+        }
+    }
+
+    chain.v.assign(b, e);
+}
+
+bool cut_rewriter(Command& c, std::vector<Command>& code) {
+
+    bool is_regex = (c.function == (void*)recutn);
+
+    if (c.function != (void*)cutn && !is_regex)
+        return false;
+
+    // The argument code is [string... VAL delimiter, VAL index, TUP].
+    size_t n = code.size();
+
+    if (n < 4)
+        return false;
+
+    const Command& vd = code[n-3];
+    const Command& vn = code[n-2];
+
+    if (code[n-1].cmd != Command::TUP || vd.cmd != Command::VAL || vn.cmd != Command::VAL)
+        return false;
+
+    CutChain::step_t step;
+    step.del = strings().get(vd.arg.str);
+    step.regex = (is_regex ? &regex_cache(step.del) : nullptr);
+    step.nth = (vn.arg.which == Atom::UINT ? vn.arg.uint : (UInt)vn.arg.inte);
+
+    if (step.del.empty())
+        return false;
+
+    code.resize(n - 3);
+
+    Command& inner = code.back();
+
+    if (inner.cmd == Command::FUN && inner.function == (void*)cut_chain) {
+
+        c.object = inner.object;
+        code.pop_back();
+
+    } else {
+        c.object = new CutChain;
+    }
+
+    obj::get<CutChain>(c.object).steps.push_back(step);
+    c.function = (void*)cut_chain;
+
+    return true;
+}
+
 void register_cutgrep(Functions& funcs) {
 
     funcs.add("cut",
@@ -319,6 +510,17 @@ void register_cutgrep(Functions& funcs) {
               Type(Type::TUP, { Type(Type::STRING), Type(Type::STRING), Type(Type::INT) }),
               Type(Type::STRING),
               recutn);
+
+    funcs.add_direct(cut, cut_2);
+    funcs.add_direct(cutn, cutn_3);
+    funcs.add_direct(grep, grep_2);
+    funcs.add_direct(grepif, grepif_2);
+    funcs.add_direct(replace, replace_3);
+    funcs.add_direct(recut, recut_2);
+    funcs.add_direct(recutn, recutn_3);
+
+    funcs.add_rewriter("cut", cut_rewriter);
+    funcs.add_rewriter("recut", cut_rewriter);
 }
 
 #endif
@@ -0,0 +1,1005 @@
+#ifndef __TAB_FUNCS_DISTINCT_H
+#define __TAB_FUNCS_DISTINCT_H
+
+/*
+ * Approximate distinct counting with HyperLogLog.
+ *
+ * Each value's 64-bit hash (see hash.h), mixed once more, picks one of 2^p
+ * registers with its top p bits, and the register keeps the longest run of
+ * leading zeros seen in the remaining bits. The relative error is about 1.04/sqrt(2^p).
+ *
+ * Small sketches are sparse: a sorted list of (register, value) pairs, so
+ * that a map with millions of keys and a handful of values each stays
+ * small. Once the list would take as much memory as the registers
+ * themselves, it is turned into a dense array of one byte per register.
+ */
+
+struct HyperLogLog {
+
+    static const unsigned int DEFAULT_P = 14;
+    static const unsigned int MIN_P = 4;
+    static const unsigned int MAX_P = 18;
+
+    unsigned int p;
+
+    // Entries are (index << 6) | rank, sorted, one per index.
+    std::vector<uint32_t> sparse;
+    std::vector<uint8_t> dense;
+
+    HyperLogLog(unsigned int _p = DEFAULT_P) : p(_p) {}
+
+    static unsigned int check_precision(UInt p) {
+
+        if (p < MIN_P || p > MAX_P)
+            throw std::runtime_error("The precision of 'distinct_approx' must be between " +
+                                     std::to_string(MIN_P) + " and " + std::to_string(MAX_P) + ".");
+        return p;
+    }
+
+    size_t registers() const {
+        return ((size_t)1 << p);
+    }
+
+    bool empty() const {
+        return sparse.empty() && dense.empty();
+    }
+
+    void clear() {
+        sparse.clear();
+        dense.clear();
+    }
+
+    // The map hashes of integers are mixed well enough for a table but keep
+    // patterns in the register index and rank, so they are mixed once more
+    // with the MurmurHash3 finalizer.
+    static uint64_t fmix64(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    void add(size_t _h) {
+
+        uint64_t h = fmix64(_h);
+        uint32_t index = (uint32_t)(h >> (64 - p));
+        // The guard bit bounds the rank to 64 - p + 1.
+        uint64_t w = ((uint64_t)h << p) | ((uint64_t)1 << (p - 1));
+        uint8_t rank = (uint8_t)(__builtin_clzll(w) + 1);
+
+        set(index, rank);
+    }
+
+    void set(uint32_t index, uint8_t rank) {
+
+        if (!dense.empty()) {
+
+            if (dense[index] < rank)
+                dense[index] = rank;
+
+            return;
+        }
+
+        uint32_t e = (index << 6) | rank;
+        auto i = std::lower_bound(sparse.begin(), sparse.end(), index << 6);
+
+        if (i != sparse.end() && (*i >> 6) == index) {
+
+            if ((*i & 63) < rank)
+                *i = e;
+
+            return;
+        }
+
+        sparse.insert(i, e);
+
+        if (sparse.size() * sizeof(uint32_t) > registers())
+            densify();
+    }
+
+    void densify() {
+
+        dense.assign(registers(), 0);
+
+        for (uint32_t e : sparse) {
+            dense[e >> 6] = (uint8_t)(e & 63);
+        }
+
+        sparse.clear();
+        sparse.shrink_to_fit();
+    }
+
+    void merge(const HyperLogLog& other) {
+
+        if (other.p != p)
+            throw std::runtime_error("Cannot merge 'distinct_approx' sketches of different precisions.");
+
+        if (!other.dense.empty()) {
+
+            if (dense.empty())
+                densify();
+
+            for (size_t i = 0; i < dense.size(); ++i) {
+                if (dense[i] < other.dense[i])
+                    dense[i] = other.dense[i];
+            }
+
+            return;
+        }
+
+        for (uint32_t e : other.sparse) {
+            set(e >> 6, (uint8_t)(e & 63));
+        }
+    }
+
+    UInt estimate() const {
+
+        double m = registers();
+        double sum = 0;
+        size_t zeros = 0;
+
+        if (!dense.empty()) {
+
+            for (uint8_t r : dense) {
+                sum += ::ldexp(1.0, -(int)r);
+                zeros += (r == 0);
+            }
+
+        } else {
+
+            zeros = registers() - sparse.size();
+            sum = zeros;
+
+            for (uint32_t e : sparse) {
+                sum += ::ldexp(1.0, -(int)(e & 63));
+            }
+        }
+
+        double alpha;
+
+        switch (p) {
+        case 4: alpha = 0.673; break;
+        case 5: alpha = 0.697; break;
+        case 6: alpha = 0.709; break;
+        default: alpha = 0.7213 / (1.0 + 1.079 / m); break;
+        }
+
+        double e = alpha * m * m / sum;
+
+        // Linear counting is more accurate while many registers are still empty.
+        if (e <= 2.5 * m && zeros > 0)
+            e = m * ::log(m / zeros);
+
+        return (UInt)::llround(e);
+    }
+
+    void encode(std::string& out) const {
+
+        obj::encode_atom(out, (uint8_t)p);
+        obj::encode_atom(out, (uint8_t)(dense.empty() ? 0 : 1));
+
+        if (dense.empty()) {
+            obj::encode_atom(out, (uint32_t)sparse.size());
+            out.append((const char*)sparse.data(), sparse.size() * sizeof(uint32_t));
+
+        } else {
+            out.append((const char*)dense.data(), dense.size());
+        }
+    }
+
+    void decode(const char*& ptr) {
+
+        uint8_t _p;
+        uint8_t is_dense;
+
+        obj::decode_atom(ptr, _p);
+        obj::decode_atom(ptr, is_dense);
+
+        p = _p;
+        clear();
+
+        if (is_dense) {
+            dense.assign(ptr, ptr + registers());
+            ptr += registers();
+
+        } else {
+            uint32_t n;
+            obj::decode_atom(ptr, n);
+            sparse.resize(n);
+            ::memcpy(sparse.data(), ptr, n * sizeof(uint32_t));
+            ptr += n * sizeof(uint32_t);
+        }
+    }
+};
+
+// The value of a single row carries only its hash; the copy that a map
+// stores starts a sketch from it, and every following row is added to it.
+struct AtomDistinctApprox : public obj::UInt {
+
+    HyperLogLog hll;
+    size_t h;
+
+    AtomDistinctApprox() : h(0) {}
+
+    obj::Object* clone() const {
+        AtomDistinctApprox* ret = new AtomDistinctApprox;
+        ret->v = v;
+        ret->hll = hll;
+        ret->h = h;
+        return ret;
+    }
+
+    // The registers live on the heap.
+    obj::Object* clone_in(obj::Arena&) const {
+        return nullptr;
+    }
+
+    void merge_start() {
+
+        if (hll.empty())
+            hll.add(h);
+    }
+
+    void merge(const obj::Object* o) {
+
+        const AtomDistinctApprox& x = obj::get<AtomDistinctApprox>(o);
+
+        if (x.hll.empty()) {
+            hll.add(x.h);
+        } else {
+            hll.merge(x.hll);
+        }
+    }
+
+    void merge_end() {
+        v = hll.estimate();
+    }
+
+    size_t bytes() const {
+        return hll.sparse.capacity() * sizeof(uint32_t) + hll.dense.capacity();
+    }
+
+    void encode(std::string& out) const {
+        obj::encode_atom(out, v);
+        obj::encode_atom(out, h);
+        hll.encode(out);
+    }
+
+    void decode(const char*& p) {
+        obj::decode_atom(p, v);
+        obj::decode_atom(p, h);
+        hll.decode(p);
+    }
+};
+
+void distinct_approx_atom(const obj::Object* in, obj::Object*& out) {
+
+    AtomDistinctApprox& o = obj::get<AtomDistinctApprox>(out);
+
+    o.h = in->hash();
+    o.v = 1;
+}
+
+void distinct_approx_atom_p(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    AtomDistinctApprox& o = obj::get<AtomDistinctApprox>(out);
+
+    o.hll.p = HyperLogLog::check_precision(obj::get<obj::UInt>(args.v[1]).v);
+    o.h = args.v[0]->hash();
+    o.v = 1;
+}
+
+UInt distinct_approx_seq(obj::Object* seq, unsigned int p) {
+
+    HyperLogLog hll(p);
+
+    while (1) {
+
+        obj::Object* next = seq->next();
+
+        if (!next) break;
+
+        hll.add(next->hash());
+    }
+
+    return hll.estimate();
+}
+
+// Hashes the elements the same way as the atoms a sequence over the array gives.
+template <typename T>
+UInt distinct_approx_arratom(obj::Object* arr, unsigned int p) {
+
+    HyperLogLog hll(p);
+
+    for (const T& x : obj::get< obj::ArrayAtom<T> >(arr).v) {
+        hll.add(obj::Hash<T>()(x));
+    }
+
+    return hll.estimate();
+}
+
+UInt distinct_approx_arr(obj::Object* arr, unsigned int p) {
+
+    HyperLogLog hll(p);
+
+    for (const obj::Object* x : obj::get<obj::ArrayObject>(arr).v) {
+        hll.add(x->hash());
+    }
+
+    return hll.estimate();
+}
+
+// F is one of the functions above, called with the default precision or the given one.
+template <UInt (*F)(obj::Object*, unsigned int)>
+void distinct_approx_many(const obj::Object* in, obj::Object*& out) {
+
+    obj::get<obj::UInt>(out).v = F((obj::Object*)in, HyperLogLog::DEFAULT_P);
+}
+
+template <UInt (*F)(obj::Object*, unsigned int)>
+void distinct_approx_many_p(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    unsigned int p = HyperLogLog::check_precision(obj::get<obj::UInt>(args.v[1]).v);
+
+    obj::get<obj::UInt>(out).v = F(args.v[0], p);
+}
+
+template <UInt (*F)(obj::Object*, unsigned int)>
+Functions::func_t distinct_approx_pick(bool with_p) {
+    return (with_p ? distinct_approx_many_p<F> : distinct_approx_many<F>);
+}
+
+Functions::func_t distinct_approx_checker(const Type& args, Type& ret, obj::Object*& obj) {
+
+    const Type* x = &args;
+    bool with_p = false;
+
+    // Only an integer literal is taken for the precision, so that a pair like
+    // (page, count(@)) is counted as a value.
+    if (args.type == Type::TUP && args.tuple && args.tuple->size() == 2 &&
+        args.tuple->at(1).literal && check_integer(args.tuple->at(1))) {
+        x = &(args.tuple->at(0));
+        with_p = true;
+    }
+
+    ret = Type(Type::UINT);
+
+    if (x->type == Type::SEQ) {
+        return distinct_approx_pick<distinct_approx_seq>(with_p);
+
+    } else if (x->type == Type::ARR) {
+
+        const Type& t = x->tuple->at(0);
+
+        if (t.type == Type::ATOM) {
+
+            switch (t.atom) {
+            case Type::INT:
+                return distinct_approx_pick< distinct_approx_arratom<Int> >(with_p);
+            case Type::UINT:
+                return distinct_approx_pick< distinct_approx_arratom<UInt> >(with_p);
+            case Type::REAL:
+                return distinct_approx_pick< distinct_approx_arratom<Real> >(with_p);
+            case Type::STRING:
+                return distinct_approx_pick< distinct_approx_arratom<std::string> >(with_p);
+            }
+
+            return nullptr;
+        }
+
+        return distinct_approx_pick<distinct_approx_arr>(with_p);
+
+    } else if (x->type == Type::ATOM || x->type == Type::TUP) {
+        obj = new AtomDistinctApprox;
+        return (with_p ? distinct_approx_atom_p : distinct_approx_atom);
+    }
+
+    return nullptr;
+}
+
+/*
+ * Exact distinct values.
+ *
+ * countdistinct(x) and distinct(x) keep a set of the values seen rather
+ * than every value like array() does. A set of a few values is a plain
+ * vector searched linearly, which is smaller and faster than a hash table
+ * for the many map keys that only ever see a handful of values; it moves
+ * to a FlatMap once it grows past DistinctSet::SMALL values.
+ */
+
+template <typename T>
+struct DistinctAtoms {
+
+    typedef T key_t;
+    typedef obj::Hash<T> hash_t;
+    typedef std::equal_to<T> eq_t;
+
+    static T copy(const T& x) { return x; }
+    static void drop(T&) {}
+
+    // Long strings' own buffers are not counted.
+    static const size_t BYTES = 0;
+};
+
+struct DistinctObjects {
+
+    typedef obj::Object* key_t;
+    typedef obj::ObjectHash hash_t;
+    typedef obj::ObjectEq eq_t;
+
+    static obj::Object* copy(obj::Object* x) { return x->clone(); }
+    static void drop(obj::Object*& x) { delete x; }
+
+    // A rough guess, like for map values.
+    static const size_t BYTES = 64;
+};
+
+template <typename Keys>
+struct DistinctSet {
+
+    typedef typename Keys::key_t key_t;
+    typedef obj::FlatMap<key_t, char, typename Keys::hash_t, typename Keys::eq_t> table_t;
+
+    static const size_t SMALL = 8;
+
+    std::vector<key_t> small;
+    table_t* table;
+
+    DistinctSet() : table(nullptr) {}
+
+    DistinctSet(const DistinctSet&) = delete;
+    DistinctSet& operator=(const DistinctSet&) = delete;
+
+    ~DistinctSet() {
+        clear();
+    }
+
+    size_t size() const {
+        return (table ? table->size() : small.size());
+    }
+
+    size_t bytes() const {
+        return small.capacity() * sizeof(key_t) + (table ? table->bytes() : 0) + size() * Keys::BYTES;
+    }
+
+    // Stores a copy of 'x' if it is not in the set yet.
+    void add(const key_t& x) {
+
+        if (table) {
+            table->find_or_insert(x, [&x]() { return Keys::copy(x); });
+            return;
+        }
+
+        typename Keys::eq_t eq;
+
+        for (const key_t& y : small) {
+            if (eq(y, x))
+                return;
+        }
+
+        if (small.size() == SMALL) {
+
+            table = new table_t;
+
+            for (const key_t& y : small) {
+                table->emplace(y, 0);
+            }
+
+            small.clear();
+            small.shrink_to_fit();
+
+            table->emplace(Keys::copy(x), 0);
+            return;
+        }
+
+        small.push_back(Keys::copy(x));
+    }
+
+    // Calls 'f' on every value, in the order they were first added.
+    template <typename F>
+    void each(F f) {
+
+        if (table) {
+            for (auto& i : *table) {
+                f(i.first);
+            }
+
+        } else {
+            for (key_t& i : small) {
+                f(i);
+            }
+        }
+    }
+
+    // Forgets the values without dropping them, once 'each' has taken them.
+    void release() {
+        delete table;
+        table = nullptr;
+        small.clear();
+    }
+
+    void clear() {
+        each(Keys::drop);
+        release();
+    }
+};
+
+// The value of a single row carries only 'x'; the copy that a map stores
+// starts a set from it.
+template <typename T>
+struct AtomCountDistinct : public obj::UInt {
+
+    T x;
+    DistinctSet< DistinctAtoms<T> > set;
+
+    AtomCountDistinct() : x() {}
+
+    obj::Object* clone() const {
+        AtomCountDistinct<T>* ret = new AtomCountDistinct<T>;
+        ret->v = v;
+        ret->x = x;
+        return ret;
+    }
+
+    // The set lives on the heap.
+    obj::Object* clone_in(obj::Arena&) const {
+        return nullptr;
+    }
+
+    void merge_start() {
+        set.add(x);
+    }
+
+    void merge(const obj::Object* o) {
+        set.add(obj::get< AtomCountDistinct<T> >(o).x);
+    }
+
+    void merge_end() {
+        v = set.size();
+    }
+
+    size_t bytes() const {
+        return set.bytes();
+    }
+
+    void encode(std::string& out) const {
+        obj::encode_atom(out, v);
+        obj::encode_atom(out, x);
+    }
+
+    void decode(const char*& p) {
+        obj::decode_atom(p, v);
+        obj::decode_atom(p, x);
+    }
+};
+
+// Like above, for tuples. 'x' is borrowed from the row; copies of the row's
+// value own theirs, so that spilled rows can be decoded into them. The set
+// keeps its own clones.
+struct AtomCountDistinctObject : public obj::UInt {
+
+    obj::Object* x;
+    bool owned;
+    DistinctSet<DistinctObjects> set;
+
+    AtomCountDistinctObject() : x(nullptr), owned(false) {}
+
+    ~AtomCountDistinctObject() {
+        if (owned)
+            delete x;
+    }
+
+    obj::Object* clone() const {
+        AtomCountDistinctObject* ret = new AtomCountDistinctObject;
+        ret->v = v;
+        ret->x = (x ? x->clone() : nullptr);
+        ret->owned = true;
+        return ret;
+    }
+
+    obj::Object* clone_in(obj::Arena&) const {
+        return nullptr;
+    }
+
+    // Once in the set, the map's copy of 'x' is not needed anymore.
+    void merge_start() {
+
+        set.add(x);
+
+        if (owned)
+            delete x;
+
+        x = nullptr;
+    }
+
+    void merge(const obj::Object* o) {
+        set.add(obj::get<AtomCountDistinctObject>(o).x);
+    }
+
+    void merge_end() {
+        v = set.size();
+    }
+
+    size_t bytes() const {
+        return set.bytes();
+    }
+
+    void encode(std::string& out) const {
+        obj::encode_atom(out, v);
+        x->encode(out);
+    }
+
+    void decode(const char*& p) {
+        obj::decode_atom(p, v);
+        x->decode(p);
+    }
+};
+
+template <typename T>
+struct AtomDistinctAtom : public obj::ArrayAtom<T> {
+
+    DistinctSet< DistinctAtoms<T> > set;
+
+    obj::Object* clone() const {
+        AtomDistinctAtom<T>* ret = new AtomDistinctAtom<T>;
+        ret->v = this->v;
+        return ret;
+    }
+
+    void merge_start() {
+        for (const T& x : this->v) {
+            set.add(x);
+        }
+    }
+
+    void merge(const obj::Object* o) {
+        for (const T& x : obj::get< obj::ArrayAtom<T> >(o).v) {
+            set.add(x);
+        }
+    }
+
+    // Moves the values out of the set; the array is the only copy from then on.
+    void merge_end() {
+
+        if (set.size() == 0)
+            return;
+
+        std::vector<T>& v = this->v;
+
+        v.clear();
+        v.reserve(set.size());
+        set.each([&v](T& x) { v.push_back(std::move(x)); });
+        set.release();
+    }
+
+    size_t bytes() const {
+        return obj::ArrayAtom<T>::bytes() + set.bytes();
+    }
+};
+
+struct AtomDistinctObject : public obj::ArrayObject {
+
+    DistinctSet<DistinctObjects> set;
+
+    // The element handed out by 'distinct_tuple' is borrowed from the row.
+    bool borrowed;
+
+    AtomDistinctObject() : borrowed(false) {}
+
+    ~AtomDistinctObject() {
+        if (borrowed)
+            v.clear();
+    }
+
+    obj::Object* clone() const {
+        AtomDistinctObject* ret = new AtomDistinctObject;
+        ret->v.reserve(v.size());
+
+        for (const Object* s : v) {
+            ret->v.push_back(s->clone());
+        }
+
+        return ret;
+    }
+
+    void merge_start() {
+        for (obj::Object* x : v) {
+            set.add(x);
+        }
+    }
+
+    void merge(const obj::Object* o) {
+        for (obj::Object* x : obj::get<obj::ArrayObject>(o).v) {
+            set.add(x);
+        }
+    }
+
+    void merge_end() {
+
+        if (set.size() == 0)
+            return;
+
+        clear();
+        v.reserve(set.size());
+        set.each([this](obj::Object* x) { v.push_back(x); });
+        set.release();
+    }
+
+    size_t bytes() const {
+        return obj::ArrayObject::bytes() + set.bytes();
+    }
+};
+
+template <typename T>
+void countdistinct_atom(const obj::Object* in, obj::Object*& out) {
+
+    AtomCountDistinct<T>& o = obj::get< AtomCountDistinct<T> >(out);
+
+    o.x = obj::get< obj::Atom<T> >(in).v;
+    o.v = 1;
+}
+
+void countdistinct_tuple(const obj::Object* in, obj::Object*& out) {
+
+    AtomCountDistinctObject& o = obj::get<AtomCountDistinctObject>(out);
+
+    o.x = (obj::Object*)in;
+    o.v = 1;
+}
+
+template <typename T>
+void countdistinct_seq_atom(const obj::Object* in, obj::Object*& out) {
+
+    obj::Object* seq = (obj::Object*)in;
+    DistinctSet< DistinctAtoms<T> > set;
+
+    while (1) {
+
+        obj::Object* next = seq->next();
+
+        if (!next) break;
+
+        set.add(obj::get< obj::Atom<T> >(next).v);
+    }
+
+    obj::get<obj::UInt>(out).v = set.size();
+}
+
+void countdistinct_seq(const obj::Object* in, obj::Object*& out) {
+
+    obj::Object* seq = (obj::Object*)in;
+    DistinctSet<DistinctObjects> set;
+
+    while (1) {
+
+        obj::Object* next = seq->next();
+
+        if (!next) break;
+
+        set.add(next);
+    }
+
+    obj::get<obj::UInt>(out).v = set.size();
+}
+
+template <typename T>
+void countdistinct_arratom(const obj::Object* in, obj::Object*& out) {
+
+    DistinctSet< DistinctAtoms<T> > set;
+
+    for (const T& x : obj::get< obj::ArrayAtom<T> >(in).v) {
+        set.add(x);
+    }
+
+    obj::get<obj::UInt>(out).v = set.size();
+}
+
+void countdistinct_arr(const obj::Object* in, obj::Object*& out) {
+
+    DistinctSet<DistinctObjects> set;
+
+    for (obj::Object* x : obj::get<obj::ArrayObject>(in).v) {
+        set.add(x);
+    }
+
+    obj::get<obj::UInt>(out).v = set.size();
+}
+
+template <typename T>
+void distinct_atom(const obj::Object* in, obj::Object*& out) {
+
+    std::vector<T>& v = obj::get< obj::ArrayAtom<T> >(out).v;
+
+    v.clear();
+    v.push_back(obj::get< obj::Atom<T> >(in).v);
+}
+
+void distinct_tuple(const obj::Object* in, obj::Object*& out) {
+
+    AtomDistinctObject& o = obj::get<AtomDistinctObject>(out);
+
+    o.borrowed = true;
+    o.v.clear();
+    o.v.push_back((obj::Object*)in);
+}
+
+template <typename T>
+void distinct_take(DistinctSet< DistinctAtoms<T> >& set, obj::Object* out) {
+
+    std::vector<T>& v = obj::get< obj::ArrayAtom<T> >(out).v;
+
+    v.clear();
+    v.reserve(set.size());
+    set.each([&v](T& x) { v.push_back(std::move(x)); });
+    set.release();
+}
+
+void distinct_take(DistinctSet<DistinctObjects>& set, obj::Object* out) {
+
+    obj::ArrayObject& o = obj::get<obj::ArrayObject>(out);
+
+    o.clear();
+    o.v.reserve(set.size());
+    set.each([&o](obj::Object* x) { o.v.push_back(x); });
+    set.release();
+}
+
+template <typename T>
+void distinct_seq_atom(const obj::Object* in, obj::Object*& out) {
+
+    obj::Object* seq = (obj::Object*)in;
+    DistinctSet< DistinctAtoms<T> > set;
+
+    while (1) {
+
+        obj::Object* next = seq->next();
+
+        if (!next) break;
+
+        set.add(obj::get< obj::Atom<T> >(next).v);
+    }
+
+    distinct_take(set, out);
+}
+
+void distinct_seq(const obj::Object* in, obj::Object*& out) {
+
+    obj::Object* seq = (obj::Object*)in;
+    DistinctSet<DistinctObjects> set;
+
+    while (1) {
+
+        obj::Object* next = seq->next();
+
+        if (!next) break;
+
+        set.add(next);
+    }
+
+    distinct_take(set, out);
+}
+
+template <typename T>
+void distinct_arratom(const obj::Object* in, obj::Object*& out) {
+
+    DistinctSet< DistinctAtoms<T> > set;
+
+    for (const T& x : obj::get< obj::ArrayAtom<T> >(in).v) {
+        set.add(x);
+    }
+
+    distinct_take(set, out);
+}
+
+void distinct_arr(const obj::Object* in, obj::Object*& out) {
+
+    DistinctSet<DistinctObjects> set;
+
+    for (obj::Object* x : obj::get<obj::ArrayObject>(in).v) {
+        set.add(x);
+    }
+
+    distinct_take(set, out);
+}
+
+// COUNT picks countdistinct, otherwise distinct.
+template <bool COUNT>
+Functions::func_t distinct_checker(const Type& args, Type& ret, obj::Object*& obj) {
+
+    if (args.type == Type::SEQ || args.type == Type::ARR) {
+
+        const Type& t = args.tuple->at(0);
+        bool seq = (args.type == Type::SEQ);
+
+        if (COUNT) {
+            ret = Type(Type::UINT);
+        } else {
+            ret = Type(Type::ARR);
+            ret.push(t);
+        }
+
+        if (t.type == Type::ATOM) {
+
+            switch (t.atom) {
+            case Type::INT:
+                if (COUNT) return (seq ? countdistinct_seq_atom<Int> : countdistinct_arratom<Int>);
+                return (seq ? distinct_seq_atom<Int> : distinct_arratom<Int>);
+            case Type::UINT:
+                if (COUNT) return (seq ? countdistinct_seq_atom<UInt> : countdistinct_arratom<UInt>);
+                return (seq ? distinct_seq_atom<UInt> : distinct_arratom<UInt>);
+            case Type::REAL:
+                if (COUNT) return (seq ? countdistinct_seq_atom<Real> : countdistinct_arratom<Real>);
+                return (seq ? distinct_seq_atom<Real> : distinct_arratom<Real>);
+            case Type::STRING:
+                if (COUNT) return (seq ? countdistinct_seq_atom<std::string> : countdistinct_arratom<std::string>);
+                return (seq ? distinct_seq_atom<std::string> : distinct_arratom<std::string>);
+            }
+
+            return nullptr;
+        }
+
+        if (COUNT)
+            return (seq ? countdistinct_seq : countdistinct_arr);
+
+        return (seq ? distinct_seq : distinct_arr);
+
+    } else if (args.type == Type::ATOM) {
+
+        if (COUNT) {
+            ret = Type(Type::UINT);
+        } else {
+            ret = Type(Type::ARR);
+            ret.push(args);
+        }
+
+        switch (args.atom) {
+        case Type::INT:
+            if (COUNT) { obj = new AtomCountDistinct<Int>; return countdistinct_atom<Int>; }
+            obj = new AtomDistinctAtom<Int>;
+            return distinct_atom<Int>;
+        case Type::UINT:
+            if (COUNT) { obj = new AtomCountDistinct<UInt>; return countdistinct_atom<UInt>; }
+            obj = new AtomDistinctAtom<UInt>;
+            return distinct_atom<UInt>;
+        case Type::REAL:
+            if (COUNT) { obj = new AtomCountDistinct<Real>; return countdistinct_atom<Real>; }
+            obj = new AtomDistinctAtom<Real>;
+            return distinct_atom<Real>;
+        case Type::STRING:
+            if (COUNT) { obj = new AtomCountDistinct<std::string>; return countdistinct_atom<std::string>; }
+            obj = new AtomDistinctAtom<std::string>;
+            return distinct_atom<std::string>;
+        }
+
+        return nullptr;
+
+    } else if (args.type == Type::TUP) {
+
+        if (COUNT) {
+            ret = Type(Type::UINT);
+            obj = new AtomCountDistinctObject;
+            return countdistinct_tuple;
+        }
+
+        ret = Type(Type::ARR);
+        ret.push(args);
+
+        obj = new AtomDistinctObject;
+        return distinct_tuple;
+    }
+
+    return nullptr;
+}
+
+void register_distinct(Functions& funcs) {
+
+    funcs.add_poly("countdistinct", distinct_checker<true>);
+    funcs.add_poly("distinct", distinct_checker<false>);
+    funcs.add_poly("distinct_approx", distinct_approx_checker);
+}
+
+#endif
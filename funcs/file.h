@@ -1,63 +1,122 @@
 #ifndef __TAB_FUNCS_FILE_H
 #define __TAB_FUNCS_FILE_H
 
+/*
+ * Input is read in large blocks and split into batches of up to 'BATCH'
+ * lines at a time. A batch is a column of (begin, end) spans into the
+ * block buffer, found with memchr in one tight loop; handing out a line is
+ * then just an index bump. The buffer is only refilled once the batch is
+ * used up, so spans stay valid for the lifetime of their batch.
+ */
+
 struct Linereader {
 
+    static const size_t BATCH = 1024;
+
+    struct span_t {
+        const char* b;
+        const char* e;
+    };
+
     std::istream& infile;
 
-    char bufb[64*1024];
-    char* bufe;
-    char* bufi;
-    char* bufi_p;
+    std::vector<char> buf;
+    size_t beg;
+    size_t end;
+    bool eof;
+
+    std::vector<span_t> lines;
+    size_t linei;
 
     Linereader(std::istream& i) :
-        infile(i), bufe(bufb + sizeof(bufb)), bufi(bufe), bufi_p(bufi)
-        {}
+        infile(i), buf(64*1024), beg(0), end(0), eof(false), linei(0)
+        {
+            lines.reserve(BATCH);
+        }
 
     void populate() {
 
-        infile.read(bufb, bufe - bufb);
-        bufi = bufb;
-        bufi_p = bufi;
+        if (beg > 0) {
+            std::copy(buf.begin() + beg, buf.begin() + end, buf.begin());
+            end -= beg;
+            beg = 0;
+        }
+
+        if (end == buf.size()) {
+            buf.resize(buf.size() * 2);
+        }
+
+        infile.read(buf.data() + end, buf.size() - end);
+        end += infile.gcount();
 
         if (!infile) {
-            bufe = bufb + infile.gcount();
+            eof = true;
         }
     }
-    
-    bool getline(std::string& s) {
-        
-        s.clear();
 
-        if (bufi == bufe) {
+    bool batch() {
+
+        lines.clear();
+        linei = 0;
+
+        while (1) {
+
+            const char* p = buf.data() + beg;
+            const char* e = buf.data() + end;
+
+            while (lines.size() < BATCH) {
+
+                const char* nl = (const char*)::memchr(p, '\n', e - p);
+
+                if (nl == nullptr)
+                    break;
+
+                lines.push_back(span_t{p, nl});
+                p = nl + 1;
+            }
+
+            beg = p - buf.data();
+
+            if (!lines.empty())
+                return true;
+
+            if (eof) {
+
+                if (beg == end)
+                    return false;
+
+                lines.push_back(span_t{p, e});
+                beg = end;
+                return true;
+            }
+
             populate();
         }
+    }
 
-        if (bufi == bufe) {
+    bool getline(const char*& b, const char*& e) {
+
+        if (linei == lines.size() && !batch()) {
             return false;
         }
-        
-        while (1) {
 
-            if (*bufi == '\n') {
-                s.append(bufi_p, bufi);
-                ++bufi;
-                bufi_p = bufi;
-                return true;
-            }
+        const span_t& s = lines[linei++];
+        b = s.b;
+        e = s.e;
+        return true;
+    }
 
-            ++bufi;
+    bool getline(std::string& s) {
 
-            if (bufi == bufe) {
-                s.append(bufi_p, bufi);
-                populate();
+        const char* b;
+        const char* e;
 
-                if (bufi == bufe) {
-                    return !(s.empty());
-                }
-            }
+        if (!getline(b, e)) {
+            s.clear();
+            return false;
         }
 
+        s.assign(b, e);
         return true;
     }
 };
@@ -82,6 +141,8 @@ struct SeqFile : public obj::SeqBase {
 
         return holder;
     }
+
+    bool scratch() const { return true; }
 };
 
 
@@ -0,0 +1,153 @@
+#ifndef __TAB_FUNCS_GROUP_H
+#define __TAB_FUNCS_GROUP_H
+
+/*
+ * Streaming group-by over input that is already sorted by key.
+ *
+ * group(x) reads (key, value) pairs and merges the values of consecutive
+ * equal keys, exactly like storing them into a map would, but hands out
+ * each group as soon as its key changes. Only the current group is held in
+ * memory. Keys must come in ascending or descending order (decided by the
+ * first change of key); a key out of that order stops the program with an
+ * error rather than silently emitting the same group twice.
+ */
+
+struct SeqGroup : public obj::SeqBase {
+
+    obj::Object* seq;
+
+    // The group being merged, and the finished group handed out.
+    obj::Object* key;
+    obj::Object* val;
+    obj::Object* out_key;
+    obj::Object* out_val;
+
+    obj::Tuple holder;
+    int order;
+    bool done;
+
+    SeqGroup() : seq(nullptr), key(nullptr), val(nullptr), out_key(nullptr), out_val(nullptr),
+                 order(0), done(false) {
+        holder.v.resize(2);
+    }
+
+    ~SeqGroup() {
+        reset();
+
+        // The holder's elements are owned by this sequence.
+        holder.v.clear();
+    }
+
+    void reset() {
+        delete key;
+        delete val;
+        delete out_key;
+        delete out_val;
+
+        key = val = out_key = out_val = nullptr;
+        order = 0;
+        done = false;
+    }
+
+    void wrap(obj::Object* s) {
+        reset();
+        seq = s;
+    }
+
+    void start(obj::Tuple& t) {
+        key = t.v[0]->clone();
+        val = t.v[1]->clone();
+        val->merge_start();
+    }
+
+    obj::Object* finish() {
+
+        delete out_key;
+        delete out_val;
+
+        out_key = key;
+        out_val = val;
+        key = val = nullptr;
+
+        out_val->merge_end();
+
+        holder.v[0] = out_key;
+        holder.v[1] = out_val;
+        return &holder;
+    }
+
+    void check_order(obj::Object* k) {
+
+        int o = (key->less(k) ? 1 : -1);
+
+        if (order == 0) {
+            order = o;
+
+        } else if (order != o) {
+            throw std::runtime_error("The keys passed to 'group' are not sorted; use a map instead.");
+        }
+    }
+
+    obj::Object* next() {
+
+        if (done)
+            return nullptr;
+
+        while (1) {
+
+            obj::Object* next = seq->next();
+
+            if (!next) {
+                done = true;
+
+                if (key == nullptr)
+                    return nullptr;
+
+                return finish();
+            }
+
+            obj::Tuple& t = obj::get<obj::Tuple>(next);
+
+            if (key == nullptr) {
+                start(t);
+
+            } else if (key->eq(t.v[0])) {
+                val->merge(t.v[1]);
+
+            } else {
+                check_order(t.v[0]);
+
+                obj::Object* ret = finish();
+                start(t);
+                return ret;
+            }
+        }
+    }
+};
+
+void group(const obj::Object* in, obj::Object*& out) {
+
+    out->wrap((obj::Object*)in);
+}
+
+Functions::func_t group_checker(const Type& args, Type& ret, obj::Object*& obj) {
+
+    if (args.type != Type::SEQ || !args.tuple || args.tuple->size() != 1)
+        return nullptr;
+
+    const Type& pair = args.tuple->at(0);
+
+    if (pair.type != Type::TUP || !pair.tuple || pair.tuple->size() != 2)
+        return nullptr;
+
+    ret = args;
+    obj = new SeqGroup;
+    return group;
+}
+
+void register_group(Functions& funcs) {
+
+    funcs.add_poly("group", group_checker);
+}
+
+#endif
@@ -52,16 +52,26 @@ void hist(const obj::Object* in, obj::Object*& out) {
 
     obj::ArrayObject& o = obj::get<obj::ArrayObject>(out);
 
-    o.clear();
-
-    for (size_t i = 0; i < buckets.size(); ++i) {
+    // The bucket tuples are reused when the bucket count stays the same.
+    while (o.v.size() > n) {
+        delete o.v.back();
+        o.v.pop_back();
+    }
 
+    while (o.v.size() < n) {
         obj::Tuple* x = new obj::Tuple;
-        x->v.push_back(new obj::Real((i + 1) * bucketsize + min));
-        x->v.push_back(new obj::UInt(buckets[i]));
+        x->v.push_back(new obj::Real);
+        x->v.push_back(new obj::UInt);
 
         o.v.push_back(x);
     }
+
+    for (size_t i = 0; i < n; ++i) {
+
+        obj::Tuple& x = obj::get<obj::Tuple>(o.v[i]);
+        obj::get<obj::Real>(x.v[0]).v = (i + 1) * bucketsize + min;
+        obj::get<obj::UInt>(x.v[1]).v = buckets[i];
+    }
 }
 
 void register_hist(Functions& funcs) {
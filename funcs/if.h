@@ -1,50 +1,33 @@
 #ifndef __TAB_FUNCS_IF_H
 #define __TAB_FUNCS_IF_H
 
-void iffun(const obj::Object* in, obj::Object*& out) {
+template <typename M>
+struct hasfun {
 
-    obj::Tuple& args = obj::get<obj::Tuple>(in);
-    obj::UInt& z = obj::get<obj::UInt>(args.v[0]);
+    static void doit_2(const obj::Object* a0, const obj::Object* a1, obj::Object*& out) {
 
-    if (z.v == 0) {
-        out = args.v[2];
-    } else {
-        out = args.v[1];
-    }
-}
-
-void hasfun(const obj::Object* in, obj::Object*& out) {
-
-    obj::Tuple& args = obj::get<obj::Tuple>(in);
-    obj::MapObject& map = obj::get<obj::MapObject>(args.v[0]);
-    obj::Object* key = args.v[1];
-    obj::UInt& r = obj::get<obj::UInt>(out);
+        M& map = obj::get<M>(a0);
+        obj::Object* key = (obj::Object*)a1;
+        obj::UInt& r = obj::get<obj::UInt>(out);
 
-    if (map.v.find(key) == map.v.end()) {
-        r.v = 0;
-    } else {
-        r.v = 1;
+        if (map.find(key) == nullptr) {
+            r.v = 0;
+        } else {
+            r.v = 1;
+        }
     }
-}
-
-Functions::func_t if_checker(const Type& args, Type& ret, obj::Object*& obj) {
 
-    if (args.type != Type::TUP || !args.tuple || args.tuple->size() != 3)
-        return nullptr;
+    static void doit(const obj::Object* in, obj::Object*& out) {
 
-    const Type& t1 = args.tuple->at(0);
-    const Type& t2 = args.tuple->at(1);
-    const Type& t3 = args.tuple->at(2);
-
-    if (!check_integer(t1) || t2 != t3)
-        return nullptr;
+        obj::Tuple& args = obj::get<obj::Tuple>(in);
+        doit_2(args.v[0], args.v[1], out);
+    }
+};
 
-    ret = t2;
+template <typename M>
+void register_hasfun_direct(Functions& funcs) {
 
-    // 'if' will always return an argument.
-    obj = obj::nothing();
-    
-    return iffun;
+    funcs.add_direct(hasfun<M>::doit, hasfun<M>::doit_2);
 }
 
 Functions::func_t has_checker(const Type& args, Type& ret, obj::Object*& obj) {
@@ -65,13 +48,18 @@ Functions::func_t has_checker(const Type& args, Type& ret, obj::Object*& obj) {
 
     ret = Type(Type::UINT);
 
-    return hasfun;
+    return obj::map_pick<Functions::func_t,hasfun>(key);
 }
 
 void register_if(Functions& funcs) {
 
-    funcs.add_poly("if", if_checker);
     funcs.add_poly("has", has_checker);
+    register_hasfun_direct<obj::MapObject>(funcs);
+    register_hasfun_direct<obj::MapTuple>(funcs);
+    register_hasfun_direct< obj::MapAtom<Int> >(funcs);
+    register_hasfun_direct< obj::MapAtom<UInt> >(funcs);
+    register_hasfun_direct< obj::MapAtom<Real> >(funcs);
+    register_hasfun_direct< obj::MapAtom<std::string> >(funcs);
 }
 
 #endif
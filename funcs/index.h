@@ -35,8 +35,13 @@ struct index_array {
     static void doit(const obj::Object* in, obj::Object*& out) {
 
         obj::Tuple& args = obj::get<obj::Tuple>(in);
-        Obj& a = obj::get<Obj>(args.v[0]);
-        IxT& i = obj::get<IxT>(args.v[1]);
+        doit_2(args.v[0], args.v[1], out);
+    }
+
+    static void doit_2(const obj::Object* a0, const obj::Object* a1, obj::Object*& out) {
+
+        Obj& a = obj::get<Obj>(a0);
+        IxT& i = obj::get<IxT>(a1);
 
         size_t ii = __array_ix_conform(a.v.size(), i.v);
 
@@ -54,8 +59,13 @@ struct index_array<Obj,obj::Object,IxT> {
     static void doit(const obj::Object* in, obj::Object*& out) {
 
         obj::Tuple& args = obj::get<obj::Tuple>(in);
-        Obj& a = obj::get<Obj>(args.v[0]);
-        IxT& i = obj::get<IxT>(args.v[1]);
+        doit_2(args.v[0], args.v[1], out);
+    }
+
+    static void doit_2(const obj::Object* a0, const obj::Object* a1, obj::Object*& out) {
+
+        Obj& a = obj::get<Obj>(a0);
+        IxT& i = obj::get<IxT>(a1);
 
         size_t ii = __array_ix_conform(a.v.size(), i.v);
 
@@ -67,12 +77,11 @@ struct index_array<Obj,obj::Object,IxT> {
 };
 
 template <typename Obj, typename IxT1, typename IxT2>
-void slice_array(const obj::Object* in, obj::Object*& out) {
+void slice_array_3(const obj::Object* a0, const obj::Object* a1, const obj::Object* a2, obj::Object*& out) {
 
-    obj::Tuple& args = obj::get<obj::Tuple>(in);
-    Obj& a = obj::get<Obj>(args.v[0]);
-    IxT1& i1 = obj::get<IxT1>(args.v[1]);
-    IxT2& i2 = obj::get<IxT2>(args.v[2]);
+    Obj& a = obj::get<Obj>(a0);
+    IxT1& i1 = obj::get<IxT1>(a1);
+    IxT2& i2 = obj::get<IxT2>(a2);
 
     size_t ii1 = __array_ix_conform(a.v.size(), i1.v);
     size_t ii2 = __array_ix_conform(a.v.size(), i2.v);
@@ -88,6 +97,13 @@ void slice_array(const obj::Object* in, obj::Object*& out) {
     ret.v.assign(a.v.begin() + ii1, a.v.begin() + ii2 + 1);
 }
 
+template <typename Obj, typename IxT1, typename IxT2>
+void slice_array(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    slice_array_3<Obj,IxT1,IxT2>(args.v[0], args.v[1], args.v[2], out);
+}
+
 
 template <typename Obj,typename RetT,typename IxT1>
 Functions::func_t index_checker_3(const Type& args, Type& ret, obj::Object*& obj) {
@@ -138,44 +154,67 @@ Functions::func_t index_checker_2(const Type& args, Type& ret, obj::Object*& obj
     }
 }
 
-void map_index_one(const obj::Object* in, obj::Object*& out) {
+template <typename M>
+struct map_index_one {
 
-    obj::Tuple& args = obj::get<obj::Tuple>(in);
-    obj::MapObject& map = obj::get<obj::MapObject>(args.v[0]);
-    obj::Object* key = args.v[1];
+    static void doit_2(const obj::Object* a0, const obj::Object* a1, obj::Object*& out) {
 
-    auto i = map.v.find(key);
+        M& map = obj::get<M>(a0);
+        obj::Object* val = map.find((obj::Object*)a1);
+
+        if (val == nullptr)
+            throw std::runtime_error("Key is not in map");
+
+        out = val;
+    }
 
-    if (i == map.v.end())
-        throw std::runtime_error("Key is not in map");
+    static void doit(const obj::Object* in, obj::Object*& out) {
+
+        obj::Tuple& args = obj::get<obj::Tuple>(in);
+        doit_2(args.v[0], args.v[1], out);
+    }
+};
 
-    out = i->second;
+template <typename M>
+void register_map_index_direct(Functions& funcs) {
+
+    funcs.add_direct(map_index_one<M>::doit, map_index_one<M>::doit_2);
 }
 
-void map_index_tup(const obj::Object* in, obj::Object*& out) {
+template <typename M>
+struct map_index_tup {
 
-    static obj::Tuple* key = new obj::Tuple;
-    obj::Tuple& args = obj::get<obj::Tuple>(in);
-    obj::MapObject& map = obj::get<obj::MapObject>(args.v[0]);
+    static void doit(const obj::Object* in, obj::Object*& out) {
+
+        static obj::Tuple* key = new obj::Tuple;
+        obj::Tuple& args = obj::get<obj::Tuple>(in);
+        M& map = obj::get<M>(args.v[0]);
+
+        key->set(args.v.begin() + 1, args.v.end());
 
-    key->set(args.v.begin() + 1, args.v.end());
+        obj::Object* val = map.find(key);
 
-    auto i = map.v.find(key);
+        if (val == nullptr)
+            throw std::runtime_error("Key is not in map");
+
+        out = val;
+    }
+};
+
+template <typename Obj>
+void tup_index_2(const obj::Object* a0, const obj::Object* a1, obj::Object*& out) {
 
-    if (i == map.v.end())
-        throw std::runtime_error("Key is not in map");
+    obj::Tuple& tup = obj::get<obj::Tuple>(a0);
+    Obj& i = obj::get<Obj>(a1);
 
-    out = i->second;
+    out = tup.v[i.v];
 }
 
 template <typename Obj>
 void tup_index(const obj::Object* in, obj::Object*& out) {
 
     obj::Tuple& args = obj::get<obj::Tuple>(in);
-    obj::Tuple& tup = obj::get<obj::Tuple>(args.v[0]);
-    Obj& i = obj::get<Obj>(args.v[1]);
-
-    out = tup.v[i.v];
+    tup_index_2<Obj>(args.v[0], args.v[1], out);
 }
 
 Functions::func_t index_checker(const Type& args, Type& ret, obj::Object*& obj) {
@@ -212,7 +251,10 @@ Functions::func_t index_checker(const Type& args, Type& ret, obj::Object*& obj)
         obj = obj::nothing();
         ret = mval;
 
-        return (one ? map_index_one : map_index_tup);
+        if (one)
+            return obj::map_pick<Functions::func_t,map_index_one>(mkey);
+
+        return obj::map_pick<Functions::func_t,map_index_tup>(mkey);
     }
 
     if (ci.type == Type::TUP) {
@@ -276,9 +318,41 @@ Functions::func_t index_checker(const Type& args, Type& ret, obj::Object*& obj)
 }
 
 
+template <typename Obj, typename RetT, typename IxT1>
+void register_index_direct_3(Functions& funcs) {
+
+    funcs.add_direct(index_array<Obj,RetT,IxT1>::doit, index_array<Obj,RetT,IxT1>::doit_2);
+    funcs.add_direct(slice_array<Obj,IxT1,obj::UInt>, slice_array_3<Obj,IxT1,obj::UInt>);
+    funcs.add_direct(slice_array<Obj,IxT1,obj::Int>, slice_array_3<Obj,IxT1,obj::Int>);
+    funcs.add_direct(slice_array<Obj,IxT1,obj::Real>, slice_array_3<Obj,IxT1,obj::Real>);
+}
+
+template <typename Obj, typename RetT>
+void register_index_direct_2(Functions& funcs) {
+
+    register_index_direct_3<Obj,RetT,obj::UInt>(funcs);
+    register_index_direct_3<Obj,RetT,obj::Int>(funcs);
+    register_index_direct_3<Obj,RetT,obj::Real>(funcs);
+}
+
 void register_index(Functions& funcs) {
 
     funcs.add_poly("index", index_checker);
+
+    register_index_direct_2< obj::ArrayAtom<UInt>,obj::UInt >(funcs);
+    register_index_direct_2< obj::ArrayAtom<Int>,obj::Int >(funcs);
+    register_index_direct_2< obj::ArrayAtom<Real>,obj::Real >(funcs);
+    register_index_direct_2< obj::ArrayAtom<std::string>,obj::String >(funcs);
+    register_index_direct_2< obj::ArrayObject,obj::Object >(funcs);
+
+    register_map_index_direct<obj::MapObject>(funcs);
+    register_map_index_direct<obj::MapTuple>(funcs);
+    register_map_index_direct< obj::MapAtom<Int> >(funcs);
+    register_map_index_direct< obj::MapAtom<UInt> >(funcs);
+    register_map_index_direct< obj::MapAtom<Real> >(funcs);
+    register_map_index_direct< obj::MapAtom<std::string> >(funcs);
+    funcs.add_direct(tup_index<obj::UInt>, tup_index_2<obj::UInt>);
+    funcs.add_direct(tup_index<obj::Int>, tup_index_2<obj::Int>);
 }
 
 #endif
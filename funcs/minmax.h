@@ -9,6 +9,12 @@ struct AtomMinMax : public obj::Atom<T> {
         ret->v = this->v;
         return ret;
     }
+
+    obj::Object* clone_in(obj::Arena& a) const {
+        AtomMinMax<MIN,T>* ret = a.make< AtomMinMax<MIN,T> >();
+        ret->v = this->v;
+        return ret;
+    }
     
     void merge(const obj::Object* o) {
         T tmp = obj::get< obj::Atom<T> >(o).v;
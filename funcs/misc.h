@@ -23,15 +23,25 @@ void toupper(const obj::Object* in, obj::Object*& out) {
     }
 }
 
-void join(const obj::Object* in, obj::Object*& out) {
+void join_2(const obj::Object* a0, const obj::Object* a1, obj::Object*& out) {
 
-    const obj::Tuple& args = obj::get<obj::Tuple>(in);
-    const std::vector<std::string>& v = obj::get< obj::ArrayAtom<std::string> >(args.v[0]).v;
-    const std::string& sep = obj::get<obj::String>(args.v[1]).v;
+    const std::vector<std::string>& v = obj::get< obj::ArrayAtom<std::string> >(a0).v;
+    const std::string& sep = obj::get<obj::String>(a1).v;
     std::string& ret = obj::get<obj::String>(out).v;
 
     ret.clear();
 
+    if (v.empty())
+        return;
+
+    size_t n = sep.size() * (v.size() - 1);
+
+    for (const std::string& i : v) {
+        n += i.size();
+    }
+
+    ret.reserve(n);
+
     bool first = true;
 
     for (const std::string& i : v) {
@@ -46,6 +56,12 @@ void join(const obj::Object* in, obj::Object*& out) {
     }
 }
 
+void join(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    join_2(args.v[0], args.v[1], out);
+}
+
 void cat(const obj::Object* in, obj::Object*& out) {
 
     const obj::Tuple& args = obj::get<obj::Tuple>(in);
@@ -89,6 +105,7 @@ void register_misc(Functions& funcs) {
     funcs.add("tolower", Type(Type::STRING), Type(Type::STRING), tolower);
     funcs.add("toupper", Type(Type::STRING), Type(Type::STRING), toupper);
     funcs.add("join", Type(Type::TUP, { Type(Type::ARR, { Type(Type::STRING) }), Type(Type::STRING) }), Type(Type::STRING), join);
+    funcs.add_direct(join, join_2);
 
     funcs.add_poly("cat", cat_checker);
     funcs.add_poly("tuple", tuple_checker);
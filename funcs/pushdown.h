@@ -0,0 +1,263 @@
+#ifndef __TAB_FUNCS_PUSHDOWN_H
+#define __TAB_FUNCS_PUSHDOWN_H
+
+/*
+ * Predicate pushdown.
+ *
+ * Filters over the input lines, like ?[grepif(@,"ERROR"), ...] or
+ * ?[cut(@," ",8)=="500", ...], are tested directly on the bytes in the
+ * line reader's buffer. Only lines that pass are copied into a string.
+ * A literal substring test searches the whole batch at once and skips
+ * the lines in between.
+ */
+
+struct LineFilter {
+
+    enum kind_t {
+        LITERAL,
+        REGEX,
+        FIELD
+    };
+
+    kind_t kind;
+    std::string str;
+    const std::regex* regex;
+    CutChain field;
+
+    bool test(const char* b, const char* e) const {
+
+        switch (kind) {
+        case LITERAL:
+            return (::memmem(b, e - b, str.data(), str.size()) != nullptr);
+
+        case REGEX:
+            return std::regex_search(b, e, *regex);
+
+        case FIELD:
+            for (const CutChain::step_t& step : field.steps) {
+
+                if (step.regex) {
+                    cut_chain_regex(b, e, step);
+                } else {
+                    cut_chain_literal(b, e, step);
+                }
+            }
+
+            return ((size_t)(e - b) == str.size() && std::equal(b, e, str.begin()));
+        }
+
+        return false;
+    }
+};
+
+struct SeqLineFilter : public obj::SeqBase {
+
+    LineFilter filter;
+    obj::Object* seq;
+    SeqFile* file;
+    obj::String holder;
+
+    SeqLineFilter() : seq(nullptr), file(nullptr) {}
+
+    void wrap(obj::Object* s) {
+        seq = s;
+        file = dynamic_cast<SeqFile*>(s);
+    }
+
+    // Skips ahead to the first line in the current batch that contains the literal.
+    bool skip_literal(Linereader& r) {
+
+        const char* b = r.lines[r.linei].b;
+        const char* e = r.lines.back().e;
+
+        const char* hit = (const char*)::memmem(b, e - b, filter.str.data(), filter.str.size());
+
+        if (hit == nullptr) {
+            r.linei = r.lines.size();
+            return false;
+        }
+
+        // Literals never contain a newline, so the match ends inside its line.
+        hit += filter.str.size();
+
+        while (r.lines[r.linei].e < hit) {
+            ++r.linei;
+        }
+
+        return true;
+    }
+
+    obj::Object* next_file() {
+
+        Linereader& r = file->reader;
+
+        while (1) {
+
+            if (r.linei == r.lines.size() && !r.batch())
+                return nullptr;
+
+            if (filter.kind == LineFilter::LITERAL) {
+
+                if (!skip_literal(r))
+                    continue;
+
+            } else if (!filter.test(r.lines[r.linei].b, r.lines[r.linei].e)) {
+                ++r.linei;
+                continue;
+            }
+
+            const Linereader::span_t& s = r.lines[r.linei++];
+            holder.v.assign(s.b, s.e);
+            return &holder;
+        }
+    }
+
+    obj::Object* next() {
+
+        if (file)
+            return next_file();
+
+        while (1) {
+            obj::Object* ret = seq->next();
+
+            if (!ret) return ret;
+
+            const std::string& v = obj::get<obj::String>(ret).v;
+
+            if (filter.test(v.data(), v.data() + v.size()))
+                return ret;
+        }
+    }
+
+    bool scratch() const {
+        return (file ? true : seq->scratch());
+    }
+};
+
+void filter_lines(const obj::Object* in, obj::Object*& out) {
+
+    out->wrap((obj::Object*)in);
+}
+
+bool literal_regex(const std::string& s) {
+
+    if (s.empty())
+        return false;
+
+    for (char c : s) {
+        if (::strchr("\\^$.|?*+()[]{}\n", c) != nullptr)
+            return false;
+    }
+
+    return true;
+}
+
+bool is_string_val(const Command& c) {
+    return (c.cmd == Command::VAL && c.arg.which == Atom::STRING);
+}
+
+bool is_var(const Command& c, UInt var) {
+    return (c.cmd == Command::VAR && c.arg.uint == var);
+}
+
+// Recognizes a test of the generator variable that can be run on raw bytes:
+// grepif(@, "..."), cut(@, ...) == "..." and @ == "...".
+bool line_filter_match(const std::vector<Command>& code, size_t n, UInt var, LineFilter& f) {
+
+    if (n == 3 && is_var(code[0], var) && is_string_val(code[1]) &&
+        code[2].cmd == Command::FUN2 && code[2].function == (void*)grepif_2) {
+
+        f.str = strings().get(code[1].arg.str);
+
+        if (literal_regex(f.str)) {
+            f.kind = LineFilter::LITERAL;
+        } else {
+            f.kind = LineFilter::REGEX;
+            f.regex = &regex_cache(f.str);
+        }
+
+        return true;
+    }
+
+    if (n < 3 || code[n-1].cmd != Command::EQ)
+        return false;
+
+    size_t vi = (is_string_val(code[0]) ? 1 : 0);
+    size_t si = (vi == 0 ? n-2 : 0);
+
+    if (!is_var(code[vi], var) || !is_string_val(code[si]))
+        return false;
+
+    size_t nfield = n - 3;
+
+    if (nfield > 1)
+        return false;
+
+    f.kind = LineFilter::FIELD;
+    f.str = strings().get(code[si].arg.str);
+
+    if (nfield == 1) {
+
+        const Command& cut = code[vi+1];
+
+        if (cut.cmd != Command::FUN || cut.function != (void*)cut_chain)
+            return false;
+
+        f.field.steps = obj::get<CutChain>(cut.object).steps;
+    }
+
+    return true;
+}
+
+// The arguments of 'filter' are [VAR 0, GEN]: a filter directly over the input
+// lines. If the filter flag is a line test, it is moved into a SeqLineFilter
+// that sits between the input and the generator.
+bool filter_rewriter(Command& c, std::vector<Command>& code) {
+
+    if (code.size() != 2 || !is_var(code[0], 0) || code[1].cmd != Command::GEN)
+        return false;
+
+    const Type& input = code[0].type;
+
+    if (input.type != Type::SEQ || !input.tuple || input.tuple->size() != 1 ||
+        input.tuple->at(0).type != Type::ATOM || input.tuple->at(0).atom != Type::STRING)
+        return false;
+
+    Command& gen = code[1];
+    std::vector<Command>& elt = gen.closure[0]->code;
+
+    if (elt.empty() || elt.back().cmd != Command::TUP || elt.back().arg.uint < 2)
+        return false;
+
+    std::vector<size_t> starts = value_starts(elt, elt.size() - 1);
+
+    if (starts.size() != elt.back().arg.uint || starts[0] != 0)
+        return false;
+
+    SeqLineFilter* lf = new SeqLineFilter;
+
+    if (!line_filter_match(elt, starts[1], gen.arg.uint, lf->filter)) {
+        delete lf;
+        return false;
+    }
+
+    elt.erase(elt.begin() + 1, elt.begin() + starts[1]);
+    elt[0] = Command(Command::VAL, UInt(1));
+    elt[0].type = Type(Type::UINT);
+
+    Command push(Command::FUN, strings().add("filter_lines"));
+    push.type = input;
+    push.object = lf;
+    push.function = (void*)filter_lines;
+
+    code.insert(code.begin() + 1, push);
+
+    return true;
+}
+
+void register_pushdown(Functions& funcs) {
+
+    funcs.add_rewriter("filter", filter_rewriter);
+}
+
+#endif
@@ -0,0 +1,619 @@
+#ifndef __TAB_FUNCS_QUANTILE_H
+#define __TAB_FUNCS_QUANTILE_H
+
+/*
+ * Approximate quantiles with a merging t-digest.
+ *
+ * Values are summarized as a sorted list of centroids (a mean and a
+ * weight). A centroid may only grow while it spans at most one unit of the
+ * scale k(q) = COMPRESSION/(2 pi) * asin(2q - 1), which is steep near
+ * q = 0 and q = 1: centroids in the tails hold few values and the ones
+ * around the median hold many. There are about COMPRESSION/2 centroids at
+ * most, and the error in rank shrinks towards the tails, so p99 and
+ * p99.9 come out much more precise than the median.
+ *
+ * New values are buffered and folded into the centroids in batches. A
+ * digest of up to BUFFER values keeps every value as a centroid of its own
+ * and is exact, which keeps a map with many keys and few values per key
+ * both small and precise.
+ */
+
+struct TDigest {
+
+    static const unsigned int COMPRESSION = 200;
+    static const size_t BUFFER = 4 * COMPRESSION;
+
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+
+    std::vector<Centroid> centroids;
+    std::vector<double> buffer;
+
+    double total;
+    double min;
+    double max;
+
+    TDigest() : total(0), min(0), max(0) {}
+
+    bool empty() const {
+        return total == 0;
+    }
+
+    void add(double x) {
+
+        if (x != x)
+            return;
+
+        if (total == 0) {
+            min = max = x;
+        } else if (x < min) {
+            min = x;
+        } else if (x > max) {
+            max = x;
+        }
+
+        buffer.push_back(x);
+        total += 1;
+
+        if (buffer.size() >= BUFFER)
+            compress();
+    }
+
+    void merge(const TDigest& other) {
+
+        if (other.empty())
+            return;
+
+        if (total == 0) {
+            min = other.min;
+            max = other.max;
+        } else {
+            min = std::min(min, other.min);
+            max = std::max(max, other.max);
+        }
+
+        compress(&other);
+    }
+
+    // The largest quantile that a centroid starting at quantile 'q' may reach.
+    static double limit(double q) {
+
+        double k = COMPRESSION / (2 * M_PI) * ::asin(2 * q - 1) + 1;
+
+        if (k >= COMPRESSION / 4.0)
+            return 1;
+
+        return (::sin(k * 2 * M_PI / COMPRESSION) + 1) / 2;
+    }
+
+    void compress(const TDigest* other = nullptr) {
+
+        if (buffer.empty() && other == nullptr)
+            return;
+
+        std::vector<Centroid> all;
+
+        all.swap(centroids);
+
+        for (double x : buffer) {
+            all.push_back(Centroid{x, 1});
+        }
+
+        buffer.clear();
+
+        if (other) {
+            all.insert(all.end(), other->centroids.begin(), other->centroids.end());
+
+            for (double x : other->buffer) {
+                all.push_back(Centroid{x, 1});
+            }
+        }
+
+        std::sort(all.begin(), all.end(), [](const Centroid& a, const Centroid& b) {
+                return a.mean < b.mean;
+            });
+
+        total = 0;
+
+        for (const Centroid& c : all) {
+            total += c.weight;
+        }
+
+        // Up to BUFFER single values are kept as they are, so that a small
+        // digest answers exactly.
+        if (total <= BUFFER && all.size() == total) {
+            centroids.swap(all);
+            return;
+        }
+
+        Centroid cur = all[0];
+        double before = 0;
+        double next = total * limit(0);
+
+        for (size_t i = 1; i < all.size(); ++i) {
+
+            const Centroid& c = all[i];
+
+            if (before + cur.weight + c.weight <= next) {
+                cur.weight += c.weight;
+                cur.mean += (c.mean - cur.mean) * c.weight / cur.weight;
+
+            } else {
+                centroids.push_back(cur);
+                before += cur.weight;
+                next = total * limit(before / total);
+                cur = c;
+            }
+        }
+
+        centroids.push_back(cur);
+    }
+
+    // Interpolates between the centers of neighbouring centroids. For a
+    // digest that still holds single values, this is the usual linear
+    // interpolation between the two closest ranks: the median of an even
+    // number of values is the mean of the middle two.
+    // The digest must have been compressed and must not be empty.
+    double quantile(double q) const {
+
+        if (q <= 0 || centroids.size() == 1)
+            return (q <= 0 ? min : centroids[0].mean);
+
+        if (q >= 1)
+            return max;
+
+        double index = q * (total - 1) + 0.5;
+        double left = 0;
+        double prev_center = 0;
+        double prev_mean = min;
+
+        for (const Centroid& c : centroids) {
+
+            double center = left + c.weight / 2;
+
+            if (index < center)
+                return interpolate(prev_center, prev_mean, center, c.mean, index);
+
+            prev_center = center;
+            prev_mean = c.mean;
+            left += c.weight;
+        }
+
+        return interpolate(prev_center, prev_mean, total, max, index);
+    }
+
+    static double interpolate(double x0, double y0, double x1, double y1, double x) {
+
+        if (x1 <= x0)
+            return y1;
+
+        return y0 + (y1 - y0) * (x - x0) / (x1 - x0);
+    }
+
+    size_t bytes() const {
+        return centroids.capacity() * sizeof(Centroid) + buffer.capacity() * sizeof(double);
+    }
+
+    void encode(std::string& out) const {
+
+        obj::encode_atom(out, (uint32_t)centroids.size());
+        obj::encode_atom(out, (uint32_t)buffer.size());
+        obj::encode_atom(out, min);
+        obj::encode_atom(out, max);
+
+        for (const Centroid& c : centroids) {
+            obj::encode_atom(out, c.mean);
+            obj::encode_atom(out, c.weight);
+        }
+
+        for (double x : buffer) {
+            obj::encode_atom(out, x);
+        }
+    }
+
+    void decode(const char*& p) {
+
+        uint32_t nc;
+        uint32_t nb;
+
+        obj::decode_atom(p, nc);
+        obj::decode_atom(p, nb);
+        obj::decode_atom(p, min);
+        obj::decode_atom(p, max);
+
+        centroids.resize(nc);
+        buffer.resize(nb);
+        total = nb;
+
+        for (Centroid& c : centroids) {
+            obj::decode_atom(p, c.mean);
+            obj::decode_atom(p, c.weight);
+            total += c.weight;
+        }
+
+        for (double& x : buffer) {
+            obj::decode_atom(p, x);
+        }
+    }
+};
+
+double quantile_check(Real q) {
+
+    if (!(q >= 0 && q <= 1))
+        throw std::runtime_error("Quantiles must be between 0.0 and 1.0.");
+
+    return q;
+}
+
+// quantiles(x) without a list of quantiles gives these.
+const std::vector<double>& quantiles_default() {
+
+    static const std::vector<double> ret = { 0.5, 0.9, 0.95, 0.99 };
+    return ret;
+}
+
+// The value of a single row is the value itself; the copy that a map stores
+// starts a digest from it, and every following row is added to it.
+struct AtomQuantile : public obj::Real {
+
+    TDigest digest;
+    double q;
+
+    AtomQuantile() : q(0) {}
+
+    obj::Object* clone() const {
+        AtomQuantile* ret = new AtomQuantile;
+        ret->v = v;
+        ret->digest = digest;
+        ret->q = q;
+        return ret;
+    }
+
+    // The centroids live on the heap.
+    obj::Object* clone_in(obj::Arena&) const {
+        return nullptr;
+    }
+
+    void merge_start() {
+
+        if (digest.empty())
+            digest.add(v);
+    }
+
+    void merge(const obj::Object* o) {
+
+        const AtomQuantile& y = obj::get<AtomQuantile>(o);
+
+        if (y.digest.empty()) {
+            digest.add(y.v);
+        } else {
+            digest.merge(y.digest);
+        }
+    }
+
+    // NaNs are skipped, so a key may have seen no values at all.
+    void merge_end() {
+        digest.compress();
+        v = (digest.empty() ? NAN : digest.quantile(q));
+    }
+
+    size_t bytes() const {
+        return digest.bytes();
+    }
+
+    void encode(std::string& out) const {
+        obj::encode_atom(out, v);
+        obj::encode_atom(out, q);
+        digest.encode(out);
+    }
+
+    void decode(const char*& p) {
+        obj::decode_atom(p, v);
+        obj::decode_atom(p, q);
+        digest.decode(p);
+    }
+};
+
+// Like above, for a tuple with one element per quantile.
+struct AtomQuantiles : public obj::Tuple {
+
+    TDigest digest;
+    double x;
+    std::vector<double> qs;
+
+    AtomQuantiles(size_t n) : x(0), qs(n) {
+
+        for (size_t i = 0; i < n; ++i) {
+            v.push_back(new obj::Real);
+        }
+    }
+
+    obj::Object* clone() const {
+        AtomQuantiles* ret = new AtomQuantiles(qs.size());
+
+        for (size_t i = 0; i < v.size(); ++i) {
+            obj::get<obj::Real>(ret->v[i]).v = obj::get<obj::Real>(v[i]).v;
+        }
+
+        ret->digest = digest;
+        ret->x = x;
+        ret->qs = qs;
+        return ret;
+    }
+
+    obj::Object* clone_in(obj::Arena&) const {
+        return nullptr;
+    }
+
+    void merge_start() {
+
+        if (digest.empty())
+            digest.add(x);
+    }
+
+    void merge(const obj::Object* o) {
+
+        const AtomQuantiles& y = obj::get<AtomQuantiles>(o);
+
+        if (y.digest.empty()) {
+            digest.add(y.x);
+        } else {
+            digest.merge(y.digest);
+        }
+    }
+
+    void merge_end() {
+
+        digest.compress();
+
+        for (size_t i = 0; i < v.size(); ++i) {
+            obj::get<obj::Real>(v[i]).v = (digest.empty() ? NAN : digest.quantile(qs[i]));
+        }
+    }
+
+    size_t bytes() const {
+        return obj::Tuple::bytes() + digest.bytes();
+    }
+
+    void encode(std::string& out) const {
+
+        obj::encode_atom(out, x);
+
+        for (double q : qs) {
+            obj::encode_atom(out, q);
+        }
+
+        digest.encode(out);
+    }
+
+    void decode(const char*& p) {
+
+        obj::decode_atom(p, x);
+
+        for (double& q : qs) {
+            obj::decode_atom(p, q);
+        }
+
+        digest.decode(p);
+
+        for (Object* i : v) {
+            obj::get<obj::Real>(i).v = x;
+        }
+    }
+};
+
+template <typename T>
+void quantile_atom(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    AtomQuantile& o = obj::get<AtomQuantile>(out);
+
+    o.v = obj::get< obj::Atom<T> >(args.v[0]).v;
+    o.q = quantile_check(obj::get<obj::Real>(args.v[1]).v);
+}
+
+void quantiles_set(AtomQuantiles& o, double x) {
+
+    o.x = x;
+
+    for (obj::Object* i : o.v) {
+        obj::get<obj::Real>(i).v = x;
+    }
+}
+
+template <typename T>
+void quantiles_atom(const obj::Object* in, obj::Object*& out) {
+
+    quantiles_set(obj::get<AtomQuantiles>(out), obj::get< obj::Atom<T> >(in).v);
+}
+
+template <typename T>
+void quantiles_atom_q(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    AtomQuantiles& o = obj::get<AtomQuantiles>(out);
+
+    for (size_t i = 0; i < o.qs.size(); ++i) {
+        o.qs[i] = quantile_check(obj::get<obj::Real>(args.v[i + 1]).v);
+    }
+
+    quantiles_set(o, obj::get< obj::Atom<T> >(args.v[0]).v);
+}
+
+template <typename T>
+struct QuantileSeq {
+
+    static void add(TDigest& digest, obj::Object* seq) {
+
+        while (1) {
+
+            obj::Object* next = seq->next();
+
+            if (!next) break;
+
+            digest.add(obj::get< obj::Atom<T> >(next).v);
+        }
+    }
+};
+
+template <typename T>
+struct QuantileArr {
+
+    static void add(TDigest& digest, obj::Object* arr) {
+
+        for (T x : obj::get< obj::ArrayAtom<T> >(arr).v) {
+            digest.add(x);
+        }
+    }
+};
+
+template <typename S>
+void quantile_digest(TDigest& digest, obj::Object* in) {
+
+    S::add(digest, in);
+
+    if (digest.empty())
+        throw std::runtime_error("Calling 'quantile' on an empty sequence or array, or one holding only NaNs.");
+
+    digest.compress();
+}
+
+template <typename S>
+void quantile_many(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    double q = quantile_check(obj::get<obj::Real>(args.v[1]).v);
+    TDigest digest;
+
+    quantile_digest<S>(digest, args.v[0]);
+
+    obj::get<obj::Real>(out).v = digest.quantile(q);
+}
+
+template <typename S>
+void quantiles_many(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& o = obj::get<obj::Tuple>(out);
+    const std::vector<double>& qs = quantiles_default();
+    TDigest digest;
+
+    quantile_digest<S>(digest, (obj::Object*)in);
+
+    for (size_t i = 0; i < qs.size(); ++i) {
+        obj::get<obj::Real>(o.v[i]).v = digest.quantile(qs[i]);
+    }
+}
+
+template <typename S>
+void quantiles_many_q(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    obj::Tuple& o = obj::get<obj::Tuple>(out);
+    TDigest digest;
+
+    quantile_digest<S>(digest, args.v[0]);
+
+    for (size_t i = 0; i < o.v.size(); ++i) {
+        double q = quantile_check(obj::get<obj::Real>(args.v[i + 1]).v);
+        obj::get<obj::Real>(o.v[i]).v = digest.quantile(q);
+    }
+}
+
+// MANY picks quantiles, otherwise quantile.
+template <bool MANY, typename T>
+Functions::func_t quantile_pick(const Type& x, bool with_q, size_t n, obj::Object*& obj) {
+
+    if (x.type == Type::SEQ) {
+
+        if (!MANY)
+            return quantile_many< QuantileSeq<T> >;
+
+        return (with_q ? quantiles_many_q< QuantileSeq<T> > : quantiles_many< QuantileSeq<T> >);
+
+    } else if (x.type == Type::ARR) {
+
+        if (!MANY)
+            return quantile_many< QuantileArr<T> >;
+
+        return (with_q ? quantiles_many_q< QuantileArr<T> > : quantiles_many< QuantileArr<T> >);
+    }
+
+    if (!MANY) {
+        obj = new AtomQuantile;
+        return quantile_atom<T>;
+    }
+
+    AtomQuantiles* o = new AtomQuantiles(n);
+    obj = o;
+
+    if (with_q)
+        return quantiles_atom_q<T>;
+
+    o->qs = quantiles_default();
+    return quantiles_atom<T>;
+}
+
+template <bool MANY>
+Functions::func_t quantile_checker(const Type& args, Type& ret, obj::Object*& obj) {
+
+    const Type* x = &args;
+    bool with_q = false;
+
+    if (args.type == Type::TUP && args.tuple && args.tuple->size() >= 2) {
+
+        for (size_t i = 1; i < args.tuple->size(); ++i) {
+            if (!check_real(args.tuple->at(i)))
+                return nullptr;
+        }
+
+        if (!MANY && args.tuple->size() != 2)
+            return nullptr;
+
+        x = &(args.tuple->at(0));
+        with_q = true;
+
+    } else if (!MANY) {
+        return nullptr;
+    }
+
+    size_t n = (with_q ? args.tuple->size() - 1 : quantiles_default().size());
+    const Type* t = x;
+
+    if (x->type == Type::SEQ || x->type == Type::ARR)
+        t = &(x->tuple->at(0));
+
+    if (!check_numeric(*t))
+        return nullptr;
+
+    if (MANY) {
+        ret = Type(Type::TUP);
+
+        for (size_t i = 0; i < n; ++i) {
+            ret.push(Type(Type::REAL));
+        }
+
+    } else {
+        ret = Type(Type::REAL);
+    }
+
+    switch (t->atom) {
+    case Type::INT:
+        return quantile_pick<MANY,Int>(*x, with_q, n, obj);
+    case Type::UINT:
+        return quantile_pick<MANY,UInt>(*x, with_q, n, obj);
+    case Type::REAL:
+        return quantile_pick<MANY,Real>(*x, with_q, n, obj);
+    default:
+        return nullptr;
+    }
+}
+
+void register_quantile(Functions& funcs) {
+
+    funcs.add_poly("quantile", quantile_checker<false>);
+    funcs.add_poly("quantiles", quantile_checker<true>);
+}
+
+#endif
@@ -48,14 +48,342 @@ void sort_arr(const obj::Object* in, obj::Object*& out) {
     out = (obj::Object*)in;
 }
 
-void sort_map(const obj::Object* in, obj::Object*& out) {
 
-    array_from_map(in, out);
+/*
+ * External sorting.
+ *
+ * Sorting a sequence that is printed as the program's result can go beyond
+ * the memory budget set with '-m'. When it does, the elements read so far
+ * are sorted and written to a temporary file as one run, and reading goes
+ * on with an empty array. Printing then merges the runs and the last,
+ * in-memory part into one sorted stream, like GNU sort. Any other sort that
+ * outgrows the budget is an error.
+ */
 
-    obj::ArrayObject& o = obj::get<obj::ArrayObject>(out);
-    std::sort(o.v.begin(), o.v.end(), obj::ObjectLess());
+struct SortRuns {
+
+    std::vector<FILE*> files;
+    std::string buf;
+
+    SortRuns() {}
+
+    SortRuns(const SortRuns&) = delete;
+    SortRuns& operator=(const SortRuns&) = delete;
+
+    ~SortRuns() {
+        close();
+    }
+
+    void close() {
+
+        for (FILE* f : files) {
+            ::fclose(f);
+        }
+
+        files.clear();
+    }
+
+    bool empty() const {
+        return files.empty();
+    }
+
+    static void check(const obj::Object* self) {
+
+        if (obj::spill_target() != self)
+            throw std::runtime_error("A sort outgrew the memory budget set with '-m'; "
+                                     "only a sort printed as the result can be spilled to disk.");
+    }
+
+    template <typename I, typename F>
+    void write(I b, I e, F encode) {
+
+        FILE* f = ::tmpfile();
+
+        if (f == nullptr)
+            throw std::runtime_error("Could not create a temporary file to spill a sort to.");
+
+        files.push_back(f);
+
+        for (; b != e; ++b) {
+
+            buf.clear();
+            encode(buf, *b);
+
+            uint32_t n = buf.size();
+
+            if (::fwrite(&n, sizeof(n), 1, f) != 1 || ::fwrite(buf.data(), 1, n, f) != n)
+                throw std::runtime_error("Could not write spilled sort data.");
+        }
+    }
+};
+
+struct SortRunReader {
+
+    FILE* file;
+    std::string buf;
+
+    SortRunReader(FILE* f) : file(f) {
+        ::rewind(file);
+    }
+
+    // Returns the next encoded element, or nullptr at the end of the run.
+    const char* next() {
+
+        uint32_t n;
+
+        if (::fread(&n, sizeof(n), 1, file) != 1)
+            return nullptr;
+
+        buf.resize(n);
+
+        if (::fread(&buf[0], 1, n, file) != n)
+            throw std::runtime_error("Could not read spilled sort data.");
+
+        return buf.data();
+    }
+};
+
+// Prints the runs and the sorted elements 'v' as one sorted sequence.
+// Elements of run i are decoded into 'heads[i]'.
+template <typename E, typename Less, typename Decode, typename Print>
+void sort_runs_merge(SortRuns& runs, const std::vector<E>& v, std::vector<E>& heads,
+                     Less less, Decode decode, Print print) {
+
+    size_t k = runs.files.size();
+    size_t mem = 0;
+
+    std::vector<SortRunReader> readers;
+
+    for (FILE* f : runs.files) {
+        readers.emplace_back(f);
+    }
+
+    // Sources 0 to k-1 are the runs, source k is the in-memory part.
+    auto head = [&](size_t i) -> const E& {
+        return (i < k ? heads[i] : v[mem]);
+    };
+
+    auto advance = [&](size_t i) {
+
+        if (i == k)
+            return (mem < v.size());
+
+        const char* p = readers[i].next();
+
+        if (p == nullptr)
+            return false;
+
+        decode(p, heads[i]);
+        return true;
+    };
+
+    auto greater = [&](size_t a, size_t b) {
+        return less(head(b), head(a));
+    };
+
+    std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> queue(greater);
+
+    for (size_t i = 0; i <= k; ++i) {
+        if (advance(i))
+            queue.push(i);
+    }
+
+    bool first = true;
+
+    while (!queue.empty()) {
+
+        size_t i = queue.top();
+        queue.pop();
+
+        if (first) {
+            first = false;
+        } else {
+            std::cout << std::endl;
+        }
+
+        print(head(i));
+
+        if (i == k)
+            ++mem;
+
+        if (advance(i))
+            queue.push(i);
+    }
+}
+
+template <typename T>
+void sort_run_encode(std::string& out, const T& x) {
+    // Raw bytes, unlike map keys: -0.0 must still print as -0.
+    out.append((const char*)&x, sizeof(x));
+}
+
+inline void sort_run_encode(std::string& out, const std::string& x) {
+    obj::encode_atom(out, x);
 }
 
+template <typename T>
+struct SortSeqAtom : public obj::ArrayAtom<T> {
+
+    SortRuns runs;
+
+    void fill(obj::Object* seq) {
+
+        runs.close();
+        this->v.clear();
+
+        size_t budget = obj::memory_budget();
+        size_t bytes = 0;
+        bool move = seq->scratch();
+
+        while (1) {
+
+            obj::Object* next = seq->next();
+
+            if (!next) break;
+
+            if (move) {
+                this->v.push_back(std::move(obj::get< obj::Atom<T> >(next).v));
+            } else {
+                this->v.push_back(obj::get< obj::Atom<T> >(next).v);
+            }
+
+            if (budget == 0)
+                continue;
+
+            bytes += sizeof(T) + obj::heap_bytes(this->v.back());
+
+            if (bytes > budget) {
+                SortRuns::check(this);
+
+                std::sort(this->v.begin(), this->v.end());
+                runs.write(this->v.begin(), this->v.end(), [](std::string& out, const T& x) { sort_run_encode(out, x); });
+
+                this->v.clear();
+                bytes = 0;
+            }
+        }
+    }
+
+    void print() {
+
+        if (runs.empty()) {
+            obj::ArrayAtom<T>::print();
+            return;
+        }
+
+        std::vector<T> heads(runs.files.size());
+
+        sort_runs_merge(runs, this->v, heads, std::less<T>(),
+                        [](const char* p, T& x) { obj::decode_atom(p, x); },
+                        [](const T& x) { std::cout << x; });
+    }
+};
+
+struct SortSeqObject : public obj::ArrayObject {
+
+    SortRuns runs;
+
+    // A copy of the first spilled element, cloned to decode runs into.
+    obj::Object* proto;
+    std::string buf;
+
+    SortSeqObject() : proto(nullptr) {}
+
+    ~SortSeqObject() {
+        delete proto;
+    }
+
+    void fill(obj::Object* seq) {
+
+        runs.close();
+        clear();
+
+        size_t budget = obj::memory_budget();
+        size_t bytes = 0;
+        bool move = seq->scratch();
+
+        while (1) {
+
+            obj::Object* next = seq->next();
+
+            if (!next) break;
+
+            v.push_back(move ? next->steal() : next->clone());
+
+            if (budget == 0)
+                continue;
+
+            buf.clear();
+            v.back()->encode(buf);
+            bytes += 64 + buf.size();
+
+            if (bytes > budget) {
+                SortRuns::check(this);
+
+                std::sort(v.begin(), v.end(), obj::ObjectLess());
+
+                if (proto == nullptr)
+                    proto = v[0]->clone();
+
+                runs.write(v.begin(), v.end(), [](std::string& out, const obj::Object* x) { x->encode(out); });
+
+                clear();
+                bytes = 0;
+            }
+        }
+    }
+
+    void print() {
+
+        if (runs.empty()) {
+            obj::ArrayObject::print();
+            return;
+        }
+
+        std::vector<obj::Object*> heads;
+
+        for (size_t i = 0; i < runs.files.size(); ++i) {
+            heads.push_back(proto->clone());
+        }
+
+        sort_runs_merge(runs, v, heads, obj::ObjectLess(),
+                        [](const char* p, obj::Object* x) { x->decode(p); },
+                        [](obj::Object* x) { x->print(); });
+
+        for (obj::Object* x : heads) {
+            delete x;
+        }
+    }
+};
+
+template <typename M>
+struct sort_map {
+
+    static void doit(const obj::Object* in, obj::Object*& out) {
+
+        array_from_map<M>::doit(in, out);
+
+        obj::ArrayObject& o = obj::get<obj::ArrayObject>(out);
+        std::sort(o.v.begin(), o.v.end(), obj::ObjectLess());
+    }
+};
+
+// sort({...}), where nothing but the sort ever sees the map: its entries are
+// put in key order in place, comparing the keys directly, and the array of
+// pairs comes out already sorted. (Keys are unique, so ordering the pairs by
+// key alone is the same as ordering them by key and value.)
+template <typename M>
+struct sort_map_inplace {
+
+    static void doit(const obj::Object* in, obj::Object*& out) {
+
+        M& a = obj::get<M>(in);
+        a.v.sort(typename M::keys_t::less_t());
+
+        array_from_map<M>::doit(in, out);
+    }
+};
+
 void sort_seq_arr(const obj::Object* in, obj::Object*& out) {
 
     out->fill((obj::Object*)in);
@@ -69,6 +397,420 @@ void sort_seq_arratom(const obj::Object* in, obj::Object*& out) {
     sort_arratom<T>(out, out);
 }
 
+
+/*
+ * Partial sorting.
+ *
+ * head(sort(x), N) and sort(x)[-N,-1] only need the N smallest or largest
+ * elements, and sort(x)[i] only needs the one element at position i. These
+ * are rewritten to keep a bounded heap of N elements or to use nth_element
+ * instead of a full sort.
+ */
+
+template <typename A>
+struct SortLimit : public A {
+    Atom n;
+    bool largest;
+};
+
+size_t sort_limit_size(const Atom& n) {
+
+    return (n.which == Atom::INT ? (size_t)n.inte : (size_t)n.uint);
+}
+
+size_t sort_limit_index(const Atom& n, size_t size) {
+
+    switch (n.which) {
+    case Atom::INT:
+        return __array_ix_conform(size, n.inte);
+    case Atom::REAL:
+        return __array_ix_conform(size, n.real);
+    default:
+        return __array_ix_conform(size, n.uint);
+    }
+}
+
+// Orders the elements that are kept first.
+template <typename T, typename Less>
+struct SortLimitOrder {
+
+    bool largest;
+    Less less;
+
+    SortLimitOrder(bool l) : largest(l) {}
+
+    bool operator()(const T& a, const T& b) const {
+        return (largest ? less(b, a) : less(a, b));
+    }
+};
+
+// Keeps the 'k' first elements seen in a heap, topped by the one to drop next.
+template <typename T, typename Order, typename Drop>
+void sort_limit_push(std::vector<T>& heap, size_t k, const T& x, const Order& order, Drop drop) {
+
+    if (heap.size() < k) {
+        heap.push_back(x);
+        std::push_heap(heap.begin(), heap.end(), order);
+        return;
+    }
+
+    std::pop_heap(heap.begin(), heap.end(), order);
+    drop(heap.back());
+    heap.back() = x;
+    std::push_heap(heap.begin(), heap.end(), order);
+}
+
+// Turns the heap into an array in ascending order.
+template <typename T, typename Order>
+void sort_limit_finish(std::vector<T>& heap, const Order& order) {
+
+    std::sort_heap(heap.begin(), heap.end(), order);
+
+    if (order.largest)
+        std::reverse(heap.begin(), heap.end());
+}
+
+template <typename T>
+void topk_arratom(const obj::Object* in, obj::Object*& out) {
+
+    const std::vector<T>& x = obj::get< obj::ArrayAtom<T> >(in).v;
+    SortLimit< obj::ArrayAtom<T> >& o = obj::get< SortLimit< obj::ArrayAtom<T> > >(out);
+    SortLimitOrder< T,std::less<T> > order(o.largest);
+
+    o.v.resize(std::min(x.size(), sort_limit_size(o.n)));
+    std::partial_sort_copy(x.begin(), x.end(), o.v.begin(), o.v.end(), order);
+
+    if (o.largest)
+        std::reverse(o.v.begin(), o.v.end());
+}
+
+void topk_arr(const obj::Object* in, obj::Object*& out) {
+
+    const std::vector<obj::Object*>& x = obj::get<obj::ArrayObject>(in).v;
+    SortLimit<obj::ArrayObject>& o = obj::get< SortLimit<obj::ArrayObject> >(out);
+    SortLimitOrder<obj::Object*,obj::ObjectLess> order(o.largest);
+
+    std::vector<obj::Object*> tmp(std::min(x.size(), sort_limit_size(o.n)));
+    std::partial_sort_copy(x.begin(), x.end(), tmp.begin(), tmp.end(), order);
+
+    if (o.largest)
+        std::reverse(tmp.begin(), tmp.end());
+
+    o.clear();
+
+    for (obj::Object* i : tmp) {
+        o.v.push_back(i->clone());
+    }
+}
+
+template <typename T>
+void topk_seq_arratom(const obj::Object* in, obj::Object*& out) {
+
+    obj::Object* seq = (obj::Object*)in;
+    SortLimit< obj::ArrayAtom<T> >& o = obj::get< SortLimit< obj::ArrayAtom<T> > >(out);
+    SortLimitOrder< T,std::less<T> > order(o.largest);
+    size_t k = sort_limit_size(o.n);
+
+    o.v.clear();
+
+    // With k == 0 the sequence is still read to the end, like a full sort would.
+    while (1) {
+
+        obj::Object* next = seq->next();
+
+        if (!next) break;
+
+        const T& x = obj::get< obj::Atom<T> >(next).v;
+
+        if (o.v.size() < k || (k > 0 && order(x, o.v.front())))
+            sort_limit_push(o.v, k, x, order, [](T&) {});
+    }
+
+    sort_limit_finish(o.v, order);
+}
+
+void topk_seq_arr(const obj::Object* in, obj::Object*& out) {
+
+    obj::Object* seq = (obj::Object*)in;
+    SortLimit<obj::ArrayObject>& o = obj::get< SortLimit<obj::ArrayObject> >(out);
+    SortLimitOrder<obj::Object*,obj::ObjectLess> order(o.largest);
+    size_t k = sort_limit_size(o.n);
+
+    o.clear();
+
+    while (1) {
+
+        obj::Object* next = seq->next();
+
+        if (!next) break;
+
+        if (o.v.size() < k || (k > 0 && order(next, o.v.front())))
+            sort_limit_push(o.v, k, next->clone(), order, [](obj::Object* x) { delete x; });
+    }
+
+    sort_limit_finish(o.v, order);
+}
+
+// Same order as sorting (key, value) tuples.
+struct MapPairLess {
+
+    typedef std::pair<obj::Object*, obj::Object*> pair_t;
+
+    bool operator()(const pair_t& x, const pair_t& y) const {
+        if (x.first->less(y.first)) return true;
+        if (y.first->less(x.first)) return false;
+        return x.second->less(y.second);
+    }
+};
+
+template <typename M>
+void topk_map(const obj::Object* in, obj::Object*& out) {
+
+    typedef MapPairLess::pair_t pair_t;
+
+    M& a = obj::get<M>(in);
+    SortLimit<MapPairs>& o = obj::get< SortLimit<MapPairs> >(out);
+    SortLimitOrder<pair_t,MapPairLess> order(o.largest);
+    size_t k = sort_limit_size(o.n);
+
+    std::vector<pair_t> heap;
+
+    if (k > 0) {
+
+        for (const auto& i : a.v) {
+
+            pair_t x(M::key(i), i.second);
+
+            if (heap.size() < k || order(x, heap.front()))
+                sort_limit_push(heap, k, x, order, [](pair_t&) {});
+        }
+    }
+
+    sort_limit_finish(heap, order);
+
+    o.resize(heap.size());
+
+    for (size_t i = 0; i < heap.size(); ++i) {
+        o.set(i, heap[i].first, heap[i].second);
+    }
+}
+
+template <typename T>
+void select_seq_arratom(const obj::Object* in, obj::Object*& out) {
+
+    out->fill((obj::Object*)in);
+
+    SortLimit< obj::ArrayAtom<T> >& o = obj::get< SortLimit< obj::ArrayAtom<T> > >(out);
+    size_t i = sort_limit_index(o.n, o.v.size());
+
+    if (i < o.v.size())
+        std::nth_element(o.v.begin(), o.v.begin() + i, o.v.end());
+}
+
+void select_seq_arr(const obj::Object* in, obj::Object*& out) {
+
+    out->fill((obj::Object*)in);
+
+    SortLimit<obj::ArrayObject>& o = obj::get< SortLimit<obj::ArrayObject> >(out);
+    size_t i = sort_limit_index(o.n, o.v.size());
+
+    if (i < o.v.size())
+        std::nth_element(o.v.begin(), o.v.begin() + i, o.v.end(), obj::ObjectLess());
+}
+
+template <typename M>
+void select_map(const obj::Object* in, obj::Object*& out) {
+
+    array_from_map<M>::doit(in, out);
+
+    SortLimit<MapPairs>& o = obj::get< SortLimit<MapPairs> >(out);
+    size_t i = sort_limit_index(o.n, o.v.size());
+
+    if (i < o.v.size())
+        std::nth_element(o.v.begin(), o.v.begin() + i, o.v.end(), obj::ObjectLess());
+}
+
+struct SortVariant {
+    void* topk;
+    void* select;
+    obj::Object* (*make)(const Atom&, bool);
+};
+
+template <typename A>
+obj::Object* make_sort_limit(const Atom& n, bool largest) {
+    SortLimit<A>* ret = new SortLimit<A>;
+    ret->n = n;
+    ret->largest = largest;
+    return ret;
+}
+
+template <typename T>
+void add_sort_variants(std::unordered_map<void*, SortVariant>& ret) {
+
+    ret[(void*)sort_arratom<T>] = SortVariant{
+        (void*)topk_arratom<T>, nullptr, make_sort_limit< obj::ArrayAtom<T> > };
+
+    ret[(void*)sort_seq_arratom<T>] = SortVariant{
+        (void*)topk_seq_arratom<T>, (void*)select_seq_arratom<T>, make_sort_limit< obj::ArrayAtom<T> > };
+}
+
+template <typename M>
+void add_sort_map_variants(std::unordered_map<void*, SortVariant>& ret) {
+
+    ret[(void*)sort_map<M>::doit] = SortVariant{
+        (void*)topk_map<M>, (void*)select_map<M>, make_sort_limit<MapPairs> };
+
+    ret[(void*)sort_map_inplace<M>::doit] = SortVariant{
+        (void*)topk_map<M>, (void*)select_map<M>, make_sort_limit<MapPairs> };
+}
+
+const std::unordered_map<void*, SortVariant>& sort_variants() {
+
+    static std::unordered_map<void*, SortVariant> ret;
+
+    if (ret.empty()) {
+
+        add_sort_variants<Int>(ret);
+        add_sort_variants<UInt>(ret);
+        add_sort_variants<Real>(ret);
+        add_sort_variants<std::string>(ret);
+
+        ret[(void*)sort_arr] = SortVariant{
+            (void*)topk_arr, nullptr, make_sort_limit<obj::ArrayObject> };
+
+        ret[(void*)sort_seq_arr] = SortVariant{
+            (void*)topk_seq_arr, (void*)select_seq_arr, make_sort_limit<obj::ArrayObject> };
+
+        add_sort_map_variants<obj::MapObject>(ret);
+        add_sort_map_variants<obj::MapTuple>(ret);
+        add_sort_map_variants< obj::MapAtom<Int> >(ret);
+        add_sort_map_variants< obj::MapAtom<UInt> >(ret);
+        add_sort_map_variants< obj::MapAtom<Real> >(ret);
+        add_sort_map_variants< obj::MapAtom<std::string> >(ret);
+    }
+
+    return ret;
+}
+
+bool sort_limit_int(const Atom& a, Int& i) {
+
+    switch (a.which) {
+    case Atom::INT:
+        i = a.inte;
+        return true;
+    case Atom::UINT:
+        i = (Int)a.uint;
+        return (i >= 0);
+    default:
+        return false;
+    }
+}
+
+// 'code' is the argument code of head() or index(): a sort() call followed by
+// 'nlit' literals and a TUP. Switches the sort to its partial variant when
+// only a part of its result can be observed.
+bool sort_limit_rewriter(std::vector<Command>& code, size_t nlit, bool is_head) {
+
+    size_t n = code.size();
+
+    if (n < nlit + 2 || code[n-1].cmd != Command::TUP || code[n-1].arg.uint != nlit + 1)
+        return false;
+
+    for (size_t i = n - 1 - nlit; i < n - 1; ++i) {
+        if (code[i].cmd != Command::VAL || code[i].arg.which == Atom::STRING)
+            return false;
+    }
+
+    Command& sort = code[n - 2 - nlit];
+
+    if (sort.cmd != Command::FUN)
+        return false;
+
+    const auto& variants = sort_variants();
+    auto v = variants.find(sort.function);
+
+    if (v == variants.end())
+        return false;
+
+    void* f = nullptr;
+    Atom lim;
+    bool largest = false;
+
+    if (is_head) {
+
+        // head(sort(x), N)
+        Int k;
+
+        if (!sort_limit_int(code[n-2].arg, k) || k < 0)
+            return false;
+
+        f = v->second.topk;
+        lim = Atom((UInt)k);
+
+    } else if (nlit == 1) {
+
+        // sort(x)[i]
+        f = v->second.select;
+        lim = code[n-2].arg;
+
+    } else {
+
+        // sort(x)[a,b], with both ends counted from the same side.
+        Int a;
+        Int b;
+
+        if (!sort_limit_int(code[n-3].arg, a) || !sort_limit_int(code[n-2].arg, b) || a > b)
+            return false;
+
+        if (a >= 0) {
+            lim = Atom((UInt)(b + 1));
+        } else if (b < 0) {
+            lim = Atom((UInt)(-a));
+            largest = true;
+        } else {
+            return false;
+        }
+
+        f = v->second.topk;
+    }
+
+    if (f == nullptr)
+        return false;
+
+    // The sort's own object is replaced; obj::nothing() is shared, and stays.
+    if (sort.object != obj::nothing())
+        delete sort.object;
+
+    sort.object = v->second.make(lim, largest);
+    sort.function = f;
+
+    return true;
+}
+
+bool head_rewriter(Command& c, std::vector<Command>& code) {
+
+    return sort_limit_rewriter(code, 1, true);
+}
+
+bool index_rewriter(Command& c, std::vector<Command>& code) {
+
+    return (sort_limit_rewriter(code, 1, false) || sort_limit_rewriter(code, 2, false));
+}
+
+// sort({...}) sorts the map literal's own entries.
+bool sort_rewriter(Command& c, std::vector<Command>& code) {
+
+    if (code.empty() || code.back().cmd != Command::MAP)
+        return false;
+
+    const Type& t = code.back().type;
+
+    if (t.type != Type::MAP || !t.tuple)
+        return false;
+
+    c.function = (void*)obj::map_pick<Functions::func_t,sort_map_inplace>(t.tuple->at(0));
+    return true;
+}
     
 Functions::func_t sort_checker(const Type& args, Type& ret, obj::Object*& obj) {
 
@@ -109,7 +851,9 @@ Functions::func_t sort_checker(const Type& args, Type& ret, obj::Object*& obj) {
 
         ret.push(pair);
 
-        return sort_map;
+        obj = new MapPairs;
+
+        return obj::map_pick<Functions::func_t,sort_map>(args.tuple->at(0));
 
     } else if (args.type == Type::SEQ) {
 
@@ -122,18 +866,23 @@ Functions::func_t sort_checker(const Type& args, Type& ret, obj::Object*& obj) {
 
             switch (t.atom) {
             case Type::INT:
+                obj = new SortSeqAtom<Int>;
                 return sort_seq_arratom<Int>;
             case Type::UINT:
+                obj = new SortSeqAtom<UInt>;
                 return sort_seq_arratom<UInt>;
             case Type::REAL:
+                obj = new SortSeqAtom<Real>;
                 return sort_seq_arratom<Real>;
             case Type::STRING:
+                obj = new SortSeqAtom<std::string>;
                 return sort_seq_arratom<std::string>;
             }
 
             return nullptr;
             
         } else {
+            obj = new SortSeqObject;
             return sort_seq_arr;
         }
 
@@ -174,6 +923,10 @@ Functions::func_t sort_checker(const Type& args, Type& ret, obj::Object*& obj) {
 void register_sort(Functions& funcs) {
 
     funcs.add_poly("sort", sort_checker);
+
+    funcs.add_rewriter("head", head_rewriter);
+    funcs.add_rewriter("index", index_rewriter);
+    funcs.add_rewriter("sort", sort_rewriter);
 }
 
 #endif
@@ -9,6 +9,12 @@ struct AtomSum : public obj::Atom<T> {
         ret->v = this->v;
         return ret;
     }
+
+    obj::Object* clone_in(obj::Arena& a) const {
+        AtomSum<T>* ret = a.make< AtomSum<T> >();
+        ret->v = this->v;
+        return ret;
+    }
     
     void merge(const obj::Object* o) {
         this->v += obj::get< obj::Atom<T> >(o).v;
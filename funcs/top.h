@@ -0,0 +1,411 @@
+#ifndef __TAB_FUNCS_TOP_H
+#define __TAB_FUNCS_TOP_H
+
+/*
+ * Bounded top-k and bottom-k.
+ *
+ * top(x, k) keeps the k largest elements seen, bottom(x, k) the k smallest,
+ * in a heap whose front is the worst element kept, so that memory is O(k)
+ * however many elements go by. The result is sorted best first. Like
+ * sort(), a single value gives a one-element array that is merged with
+ * the others when stored into a map, keeping only the k best per key.
+ */
+
+template <typename T, bool LARGEST>
+struct TopOrder {
+    bool operator()(const T& a, const T& b) const {
+        return (LARGEST ? b < a : a < b);
+    }
+};
+
+template <bool LARGEST>
+struct TopOrderObject {
+    bool operator()(obj::Object* a, obj::Object* b) const {
+        return (LARGEST ? b->less(a) : a->less(b));
+    }
+};
+
+// 'better' is a strict order where the best element comes first.
+template <typename E, typename Better>
+bool top_wants(const std::vector<E>& v, size_t k, const E& x, Better better) {
+    return (v.size() < k || (k > 0 && better(x, v.front())));
+}
+
+// Adds 'x' after 'top_wants' agreed to it. Returns true and sets 'evicted'
+// if the heap was full and its worst element had to go.
+template <typename E, typename Better>
+bool top_insert(std::vector<E>& v, size_t k, const E& x, Better better, E& evicted) {
+
+    if (v.size() < k) {
+        v.push_back(x);
+        std::push_heap(v.begin(), v.end(), better);
+        return false;
+    }
+
+    std::pop_heap(v.begin(), v.end(), better);
+    evicted = v.back();
+    v.back() = x;
+    std::push_heap(v.begin(), v.end(), better);
+    return true;
+}
+
+template <typename T, bool LARGEST>
+void top_offer(std::vector<T>& v, size_t k, const T& x) {
+
+    TopOrder<T,LARGEST> better;
+    T evicted;
+
+    if (top_wants(v, k, x, better))
+        top_insert(v, k, x, better, evicted);
+}
+
+// Clones 'x' only if it is kept.
+template <bool LARGEST>
+void top_offer(std::vector<obj::Object*>& v, size_t k, obj::Object* x) {
+
+    TopOrderObject<LARGEST> better;
+    obj::Object* evicted = nullptr;
+
+    if (top_wants(v, k, x, better) && top_insert(v, k, x->clone(), better, evicted))
+        delete evicted;
+}
+
+// k may be given as a signed integer; a negative one would keep everything.
+// (An unsigned k of 2^63 or more is rejected the same way.)
+size_t top_k(const obj::Object* k) {
+
+    Int x = obj::get<obj::Int>(k).v;
+
+    if (x < 0)
+        throw std::runtime_error("The number of elements kept by 'top' and 'bottom' must not be negative.");
+
+    return x;
+}
+
+template <typename T, bool LARGEST>
+struct AtomTopAtom : public obj::ArrayAtom<T> {
+
+    size_t k;
+
+    AtomTopAtom() : k(0) {}
+
+    obj::Object* clone() const {
+        AtomTopAtom<T,LARGEST>* ret = new AtomTopAtom<T,LARGEST>;
+        ret->k = k;
+        ret->v = this->v;
+        return ret;
+    }
+
+    void merge(const obj::Object* o) {
+
+        for (const T& x : obj::get< obj::ArrayAtom<T> >(o).v) {
+            top_offer<T,LARGEST>(this->v, k, x);
+        }
+    }
+
+    void merge_end() {
+        std::sort_heap(this->v.begin(), this->v.end(), TopOrder<T,LARGEST>());
+    }
+
+    void encode(std::string& out) const {
+        obj::encode_atom(out, (uint64_t)k);
+        obj::ArrayAtom<T>::encode(out);
+    }
+
+    void decode(const char*& p) {
+        uint64_t _k;
+        obj::decode_atom(p, _k);
+        k = _k;
+        obj::ArrayAtom<T>::decode(p);
+    }
+};
+
+template <bool LARGEST>
+struct AtomTopObject : public obj::ArrayObject {
+
+    size_t k;
+
+    // top(a, b, ..., k) takes the top of the tuples (a, b, ...), put together in 'row'.
+    // The element handed out by 'top_tuple' is borrowed, like in array_from_tuple;
+    // merging it into a map clones it.
+    obj::Tuple row;
+    bool borrowed;
+
+    // An element to decode into when spilled data is read back into an empty
+    // array, as top(x, 0) keeps none. Borrowed along with the elements.
+    obj::Object* proto;
+
+    AtomTopObject() : k(0), borrowed(false), proto(nullptr) {}
+
+    ~AtomTopObject() {
+
+        if (borrowed) {
+            v.clear();
+        } else {
+            delete proto;
+        }
+
+        row.v.clear();
+    }
+
+    obj::Object* clone() const {
+        AtomTopObject<LARGEST>* ret = new AtomTopObject<LARGEST>;
+        ret->k = k;
+        ret->proto = (proto ? proto->clone() : nullptr);
+        ret->v.reserve(v.size());
+
+        for (const Object* s : v) {
+            ret->v.push_back(s->clone());
+        }
+
+        return ret;
+    }
+
+    void merge(const obj::Object* o) {
+
+        for (obj::Object* x : obj::get<obj::ArrayObject>(o).v) {
+            top_offer<LARGEST>(v, k, x);
+        }
+    }
+
+    void merge_end() {
+        std::sort_heap(v.begin(), v.end(), TopOrderObject<LARGEST>());
+    }
+
+    void encode(std::string& out) const {
+        obj::encode_atom(out, (uint64_t)k);
+        obj::ArrayObject::encode(out);
+    }
+
+    void decode(const char*& p) {
+
+        uint64_t _k;
+        obj::decode_atom(p, _k);
+        k = _k;
+
+        const char* q = p;
+        uint32_t n;
+        obj::decode_atom(q, n);
+
+        if (n > 0 && v.empty()) {
+
+            if (proto == nullptr)
+                throw std::runtime_error("Sanity error: decoding into an empty array.");
+
+            v.push_back(proto->clone());
+        }
+
+        obj::ArrayObject::decode(p);
+    }
+};
+
+template <typename T, bool LARGEST>
+void top_atom(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    AtomTopAtom<T,LARGEST>& o = obj::get< AtomTopAtom<T,LARGEST> >(out);
+
+    o.k = top_k(args.v[1]);
+    o.v.clear();
+
+    if (o.k > 0)
+        o.v.push_back(obj::get< obj::Atom<T> >(args.v[0]).v);
+}
+
+template <bool LARGEST>
+void top_tuple(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    AtomTopObject<LARGEST>& o = obj::get< AtomTopObject<LARGEST> >(out);
+    size_t n = args.v.size() - 1;
+
+    o.k = top_k(args.v[n]);
+    o.borrowed = true;
+    o.v.clear();
+
+    if (n == 1) {
+        o.proto = args.v[0];
+
+    } else {
+        o.row.v.assign(args.v.begin(), args.v.begin() + n);
+        o.proto = &o.row;
+    }
+
+    if (o.k > 0)
+        o.v.push_back(o.proto);
+}
+
+template <typename T, bool LARGEST>
+void top_seq_arratom(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    obj::Object* seq = args.v[0];
+    size_t k = top_k(args.v[1]);
+    std::vector<T>& v = obj::get< obj::ArrayAtom<T> >(out).v;
+
+    v.clear();
+
+    while (1) {
+
+        obj::Object* next = seq->next();
+
+        if (!next) break;
+
+        top_offer<T,LARGEST>(v, k, obj::get< obj::Atom<T> >(next).v);
+    }
+
+    std::sort_heap(v.begin(), v.end(), TopOrder<T,LARGEST>());
+}
+
+template <bool LARGEST>
+void top_seq_arr(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    obj::Object* seq = args.v[0];
+    size_t k = top_k(args.v[1]);
+    obj::ArrayObject& o = obj::get<obj::ArrayObject>(out);
+
+    o.clear();
+
+    while (1) {
+
+        obj::Object* next = seq->next();
+
+        if (!next) break;
+
+        top_offer<LARGEST>(o.v, k, next);
+    }
+
+    std::sort_heap(o.v.begin(), o.v.end(), TopOrderObject<LARGEST>());
+}
+
+template <typename T, bool LARGEST>
+void top_arratom(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    const std::vector<T>& x = obj::get< obj::ArrayAtom<T> >(args.v[0]).v;
+    size_t k = top_k(args.v[1]);
+    std::vector<T>& v = obj::get< obj::ArrayAtom<T> >(out).v;
+
+    v.clear();
+
+    for (const T& i : x) {
+        top_offer<T,LARGEST>(v, k, i);
+    }
+
+    std::sort_heap(v.begin(), v.end(), TopOrder<T,LARGEST>());
+}
+
+template <bool LARGEST>
+void top_arr(const obj::Object* in, obj::Object*& out) {
+
+    obj::Tuple& args = obj::get<obj::Tuple>(in);
+    const std::vector<obj::Object*>& x = obj::get<obj::ArrayObject>(args.v[0]).v;
+    size_t k = top_k(args.v[1]);
+    obj::ArrayObject& o = obj::get<obj::ArrayObject>(out);
+
+    o.clear();
+
+    for (obj::Object* i : x) {
+        top_offer<LARGEST>(o.v, k, i);
+    }
+
+    std::sort_heap(o.v.begin(), o.v.end(), TopOrderObject<LARGEST>());
+}
+
+template <bool LARGEST>
+Functions::func_t top_checker(const Type& args, Type& ret, obj::Object*& obj) {
+
+    if (args.type != Type::TUP || !args.tuple || args.tuple->size() < 2)
+        return nullptr;
+
+    size_t n = args.tuple->size() - 1;
+
+    if (!check_integer(args.tuple->at(n)))
+        return nullptr;
+
+    if (n > 1) {
+
+        Type x(Type::TUP);
+
+        for (size_t i = 0; i < n; ++i) {
+            x.push(args.tuple->at(i));
+        }
+
+        ret = Type(Type::ARR);
+        ret.push(x);
+
+        obj = new AtomTopObject<LARGEST>;
+        return top_tuple<LARGEST>;
+    }
+
+    const Type& x = args.tuple->at(0);
+
+    if (x.type == Type::SEQ || x.type == Type::ARR) {
+
+        const Type& t = x.tuple->at(0);
+
+        ret = Type(Type::ARR);
+        ret.push(t);
+
+        bool seq = (x.type == Type::SEQ);
+
+        if (t.type == Type::ATOM) {
+
+            switch (t.atom) {
+            case Type::INT:
+                return (seq ? top_seq_arratom<Int,LARGEST> : top_arratom<Int,LARGEST>);
+            case Type::UINT:
+                return (seq ? top_seq_arratom<UInt,LARGEST> : top_arratom<UInt,LARGEST>);
+            case Type::REAL:
+                return (seq ? top_seq_arratom<Real,LARGEST> : top_arratom<Real,LARGEST>);
+            case Type::STRING:
+                return (seq ? top_seq_arratom<std::string,LARGEST> : top_arratom<std::string,LARGEST>);
+            }
+
+            return nullptr;
+        }
+
+        return (seq ? top_seq_arr<LARGEST> : top_arr<LARGEST>);
+
+    } else if (x.type == Type::ATOM) {
+
+        ret = Type(Type::ARR);
+        ret.push(x);
+
+        switch (x.atom) {
+        case Type::INT:
+            obj = new AtomTopAtom<Int,LARGEST>;
+            return top_atom<Int,LARGEST>;
+        case Type::UINT:
+            obj = new AtomTopAtom<UInt,LARGEST>;
+            return top_atom<UInt,LARGEST>;
+        case Type::REAL:
+            obj = new AtomTopAtom<Real,LARGEST>;
+            return top_atom<Real,LARGEST>;
+        case Type::STRING:
+            obj = new AtomTopAtom<std::string,LARGEST>;
+            return top_atom<std::string,LARGEST>;
+        }
+
+        return nullptr;
+
+    } else if (x.type == Type::TUP) {
+
+        ret = Type(Type::ARR);
+        ret.push(x);
+
+        obj = new AtomTopObject<LARGEST>;
+        return top_tuple<LARGEST>;
+    }
+
+    return nullptr;
+}
+
+void register_top(Functions& funcs) {
+
+    funcs.add_poly("top", top_checker<true>);
+    funcs.add_poly("bottom", top_checker<false>);
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef __TAB_HASH_H
+#define __TAB_HASH_H
+
+namespace obj {
+
+/*
+ * Hash functions for map keys.
+ *
+ * Every hash is well mixed in all of its bits, since the map's table uses
+ * the low bits as a tag and the high bits to pick a slot. Composite keys
+ * (arrays, tuples, maps) combine the hashes of their elements in order, so
+ * that (a,b) and (b,a) hash differently.
+ */
+
+static const uint64_t HASH_K0 = 0xa0761d6478bd642fULL;
+static const uint64_t HASH_K1 = 0xe7037ed1a0b428dbULL;
+static const uint64_t HASH_K2 = 0x8ebc6af09c88c6e3ULL;
+
+// Multiplies and folds the 128-bit product.
+inline uint64_t hash_mum(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t ha = a >> 32, la = (uint32_t)a;
+    uint64_t hb = b >> 32, lb = (uint32_t)b;
+    uint64_t hi = ha * hb, lo = la * lb;
+    uint64_t m = ha * lb + la * hb;
+    return (lo + (m << 32)) ^ (hi + (m >> 32));
+#endif
+}
+
+inline size_t hash_int(uint64_t x) {
+    return hash_mum(x ^ HASH_K0, HASH_K1);
+}
+
+inline size_t hash_combine(size_t seed, size_t h) {
+    return hash_mum(seed ^ HASH_K2, h ^ HASH_K1);
+}
+
+inline uint64_t hash_read(const char* p, size_t n) {
+    uint64_t v = 0;
+    ::memcpy(&v, p, n);
+    return v;
+}
+
+// Sixteen bytes (two words) at a time, with one multiply per pair of words.
+inline size_t hash_bytes(const char* p, size_t n) {
+
+    uint64_t h = HASH_K0 ^ hash_mum(n ^ HASH_K1, HASH_K2);
+
+    while (n >= 16) {
+        h = hash_mum(hash_read(p, 8) ^ HASH_K1, hash_read(p + 8, 8) ^ h);
+        p += 16;
+        n -= 16;
+    }
+
+    if (n > 8) {
+        h = hash_mum(hash_read(p, 8) ^ HASH_K1, hash_read(p + 8, n - 8) ^ h);
+
+    } else {
+        h = hash_mum(hash_read(p, n) ^ HASH_K1, h ^ HASH_K2);
+    }
+
+    return hash_mum(h ^ HASH_K0, HASH_K2);
+}
+
+template <typename T>
+struct Hash {
+    size_t operator()(T v) const { return hash_int((uint64_t)v); }
+};
+
+template <>
+struct Hash<double> {
+    size_t operator()(double v) const {
+        // 0.0 and -0.0 compare equal, so they must hash the same.
+        if (v == 0)
+            return hash_int(0);
+
+        uint64_t x;
+        ::memcpy(&x, &v, sizeof(x));
+        return hash_int(x);
+    }
+};
+
+template <>
+struct Hash<std::string> {
+    size_t operator()(const std::string& v) const { return hash_bytes(v.data(), v.size()); }
+};
+
+}
+
+#endif
@@ -5,6 +5,11 @@ struct Functions {
 
     typedef void (*func_t)(const obj::Object*, obj::Object*&);
 
+    // Direct calling convention: arguments are passed as separate pointers
+    // instead of being packed into a tuple first.
+    typedef void (*func2_t)(const obj::Object*, const obj::Object*, obj::Object*&);
+    typedef void (*func3_t)(const obj::Object*, const obj::Object*, const obj::Object*, obj::Object*&);
+
     typedef std::pair< String, Type > key_t;
     typedef std::pair< func_t, Type > val_t;
     
@@ -14,6 +19,12 @@ struct Functions {
     
     std::unordered_map< String, checker_t > poly_funcs;
 
+    typedef bool (*rewriter_t)(Command& fun, std::vector<Command>& args);
+
+    std::unordered_map< String, rewriter_t > rewriters;
+
+    std::unordered_map< void*, std::pair<void*, UInt> > directs;
+
     typedef obj::Object* (*seqmaker_t)(const Type& arg);
 
     seqmaker_t seqmaker;
@@ -31,6 +42,19 @@ struct Functions {
         poly_funcs.insert(poly_funcs.end(), std::make_pair(n, c));
     }
 
+    void add_rewriter(const std::string& name, rewriter_t r) {
+        String n = strings().add(name);
+        rewriters.insert(rewriters.end(), std::make_pair(n, r));
+    }
+
+    void add_direct(func_t f, func2_t d) {
+        directs[(void*)f] = std::make_pair((void*)d, UInt(2));
+    }
+
+    void add_direct(func_t f, func3_t d) {
+        directs[(void*)f] = std::make_pair((void*)d, UInt(3));
+    }
+
     void add_seqmaker(seqmaker_t sm) {
         seqmaker = sm;
     }
@@ -55,6 +79,30 @@ struct Functions {
 
         throw std::runtime_error("Invalid function call: " + strings().get(name) + " " + Type::print(args));
     }
+
+    bool get_direct(void* f, void*& d, UInt& nargs) const {
+
+        auto i = directs.find(f);
+
+        if (i == directs.end())
+            return false;
+
+        d = i->second.first;
+        nargs = i->second.second;
+        return true;
+    }
+
+    // Gives a chance to replace a resolved function call and its (already typed)
+    // argument code with something cheaper.
+    bool rewrite(Command& fun, std::vector<Command>& args) const {
+
+        auto i = rewriters.find(fun.arg.str);
+
+        if (i == rewriters.end())
+            return false;
+
+        return (i->second)(fun, args);
+    }
 }; 
 
 Functions& functions_init() {
@@ -292,6 +340,206 @@ struct TypeRuntime {
 };
 
 
+/*
+ * Dead value elimination.
+ *
+ * Generator elements (or parts of tuple elements) whose values are never
+ * observed, like in count([expensive(@) : @]), are replaced by a constant.
+ */
+
+// For the first 'n' commands of 'code', returns the index where the code that
+// computes each of the resulting stack values starts. Returns an empty vector
+// if the values cannot be told apart.
+std::vector<size_t> value_starts(const std::vector<Command>& code, size_t n) {
+
+    static const size_t none = (size_t)-1;
+
+    std::vector<size_t> starts;
+    std::unordered_map< size_t, std::pair<std::vector<size_t>, size_t> > targets;
+    size_t carry = none;
+
+    for (size_t i = 0; i < n; ++i) {
+
+        const Command& c = code[i];
+
+        auto t = targets.find(i);
+
+        if (t != targets.end()) {
+            starts = t->second.first;
+            carry = t->second.second;
+        }
+
+        int p = c.pops();
+        int q = c.pushes();
+
+        if (p > (int)starts.size())
+            return std::vector<size_t>();
+
+        size_t st = i;
+
+        if (p == 0 && q > 0 && carry != none) {
+            st = carry;
+            carry = none;
+        }
+
+        for (int k = 0; k < p; ++k) {
+            st = std::min(st, starts.back());
+            starts.pop_back();
+        }
+
+        // A conditional jump's condition is part of the value computed by the
+        // code that follows it.
+        if (c.cmd == Command::JZ || c.cmd == Command::JNZ) {
+            carry = st;
+        }
+
+        if (c.cmd == Command::JMP || c.cmd == Command::JZ || c.cmd == Command::JNZ) {
+            targets[i + 1 + c.arg.uint] = std::make_pair(starts, carry);
+        }
+
+        for (int k = 0; k < q; ++k) {
+            starts.push_back(st);
+        }
+    }
+
+    for (size_t k = 1; k < starts.size(); ++k) {
+        if (starts[k] <= starts[k-1])
+            return std::vector<size_t>();
+    }
+
+    return starts;
+}
+
+// Code is pure if skipping it cannot be noticed: it assigns no variables
+// and does not consume sequences that are visible from the outside.
+bool pure_code(const std::vector<Command>& code, size_t b, size_t e) {
+
+    for (size_t i = b; i < e; ++i) {
+
+        const Command& c = code[i];
+
+        if (c.cmd == Command::VAW)
+            return false;
+
+        if (c.cmd == Command::VAR && c.type.type == Type::SEQ)
+            return false;
+
+        for (const auto& clo : c.closure) {
+            if (!pure_code(clo->code, 0, clo->code.size()))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+void kill_value(std::vector<Command>& code, size_t b, size_t e) {
+
+    if (e == b + 1 && code[b].cmd == Command::VAL)
+        return;
+
+    if (!pure_code(code, b, e))
+        return;
+
+    code.erase(code.begin() + b + 1, code.begin() + e);
+    code[b] = Command(Command::VAL, UInt(0));
+    code[b].type = Type(Type::UINT);
+}
+
+// Replaces the whole element computed by a generator closure.
+void kill_element(std::vector<Command>& code) {
+
+    kill_value(code, 0, code.size());
+}
+
+// 'code' ends with a TUP; replaces the tuple parts for which 'live' is false.
+void kill_tuple_parts(std::vector<Command>& code, const std::vector<bool>& live) {
+
+    if (code.empty() || code.back().cmd != Command::TUP || code.back().arg.uint != live.size())
+        return;
+
+    size_t n = code.size() - 1;
+    std::vector<size_t> starts = value_starts(code, n);
+
+    if (starts.size() != live.size())
+        return;
+
+    for (size_t k = live.size(); k > 0; --k) {
+
+        if (live[k-1])
+            continue;
+
+        size_t e = (k < starts.size() ? starts[k] : n);
+        kill_value(code, starts[k-1], e);
+    }
+}
+
+// Finds which parts of a tuple-typed variable are ever read. Returns false
+// if the variable is used in any other way than indexing with a literal.
+bool projected_parts(const std::vector<Command>& code, UInt var, std::vector<bool>& live) {
+
+    for (size_t i = 0; i < code.size(); ++i) {
+
+        const Command& c = code[i];
+
+        for (const auto& clo : c.closure) {
+            if (!projected_parts(clo->code, var, live))
+                return false;
+        }
+
+        if (c.cmd != Command::VAR || c.arg.uint != var)
+            continue;
+
+        if (i + 2 >= code.size())
+            return false;
+
+        const Command& ix = code[i+1];
+        const Command& fun = code[i+2];
+
+        if (ix.cmd != Command::VAL || fun.cmd != Command::FUN2 || strings().get(fun.arg.str) != "index")
+            return false;
+
+        size_t k = (ix.arg.which == Atom::UINT ? ix.arg.uint : (size_t)ix.arg.inte);
+
+        if (k >= live.size())
+            return false;
+
+        live[k] = true;
+    }
+
+    return true;
+}
+
+// The generator that feeds 'var' is only observed through tuple indexing,
+// so the parts of its elements that are never indexed are dead.
+void kill_unprojected(std::vector<Command>& source, UInt var, const Type& vartype,
+                      const std::vector<Command>& body) {
+
+    if (vartype.type != Type::TUP || !vartype.tuple || source.empty())
+        return;
+
+    size_t nparts = vartype.tuple->size();
+    std::vector<bool> live(nparts, false);
+
+    if (!projected_parts(body, var, live))
+        return;
+
+    Command& last = source.back();
+
+    if (last.cmd == Command::GEN) {
+
+        kill_tuple_parts(last.closure[0]->code, live);
+
+    } else if (last.cmd == Command::FUN && strings().get(last.arg.str) == "filter" &&
+               source.size() >= 2 && source[source.size()-2].cmd == Command::GEN && nparts >= 2) {
+
+        // The first part is the filter flag, which is always live.
+        live.insert(live.begin(), true);
+        kill_tuple_parts(source[source.size()-2].closure[0]->code, live);
+    }
+}
+
+
 Type infer_expr(std::vector<Command>& commands, TypeRuntime& typer, bool allow_empty);
 
 Type infer_gen_generator(Command& c, TypeRuntime& typer, UInt& tlvar) {
@@ -309,7 +557,9 @@ Type infer_gen_generator(Command& c, TypeRuntime& typer, UInt& tlvar) {
     tlvar = typer.add_var(strings().add("@"), toplevel);
     
     Type t = infer_expr(clo0.code, typer, false);
-    
+
+    kill_unprojected(clo1.code, tlvar, toplevel, clo0.code);
+
     Type ret(Type::SEQ);
     ret.push(t);
 
@@ -538,8 +788,94 @@ Type infer_expr(std::vector<Command>& commands, TypeRuntime& typer, bool allow_e
             break;
         }
         
+        case Command::IF:
+        {
+            if (c.closure.size() != 3)
+                throw std::runtime_error("Sanity error, 'if' without three branches.");
+
+            auto clo0 = c.closure[0];
+            auto clo1 = c.closure[1];
+            auto clo2 = c.closure[2];
+
+            Type t0 = infer_expr(clo0->code, typer);
+            Type t1 = infer_expr(clo1->code, typer);
+            Type t2 = infer_expr(clo2->code, typer);
+
+            if (!check_integer(t0))
+                throw std::runtime_error("The condition in 'if' must be an integer.");
+
+            if (t1 != t2)
+                throw std::runtime_error("Both branches of 'if' must have the same type. Got " +
+                                         Type::print(t1) + " and " + Type::print(t2));
+
+            // The result is not a literal, even when both branches are.
+            t1.literal.reset();
+
+            // cond JZ(then+1) then JMP(else) else
+            std::vector<Command> code(clo0->code);
+
+            code.emplace_back(Command::JZ, UInt(clo1->code.size() + 1));
+            code.insert(code.end(), clo1->code.begin(), clo1->code.end());
+            code.emplace_back(Command::JMP, UInt(clo2->code.size()));
+            code.insert(code.end(), clo2->code.begin(), clo2->code.end());
+
+            ci = commands.erase(ci);
+            ci = commands.insert(ci, code.begin(), code.end());
+            ci += code.size() - 1;
+
+            stack.emplace_back(t1);
+            has_type = false;
+            break;
+        }
+
+        case Command::LAND:
+        case Command::LOR:
+        {
+            if (c.closure.size() != 1)
+                throw std::runtime_error("Sanity error, logical operator without an operand.");
+
+            bool is_and = (c.cmd == Command::LAND);
+            const char* name = (is_and ? "&&" : "||");
+            auto clo = c.closure[0];
+
+            Type t1 = stack.back();
+            stack.pop_back();
+            Type t2 = infer_expr(clo->code, typer);
+
+            if (!check_integer(t1) || !check_integer(t2))
+                throw std::runtime_error(std::string("Use of '") + name + "' operator on non-integer value.");
+
+            // a JZ(b+2) b BOOL JMP(1) VAL(0)  for '&&',
+            // a JNZ(b+2) b BOOL JMP(1) VAL(1) for '||'.
+            std::vector<Command> code;
+
+            code.emplace_back(is_and ? Command::JZ : Command::JNZ, UInt(clo->code.size() + 2));
+            code.insert(code.end(), clo->code.begin(), clo->code.end());
+            code.emplace_back(Command::BOOL);
+            code.back().type = Type(Type::UINT);
+            code.emplace_back(Command::JMP, UInt(1));
+            code.emplace_back(Command::VAL, UInt(is_and ? 0 : 1));
+            code.back().type = Type(Type::UINT);
+
+            ci = commands.erase(ci);
+            ci = commands.insert(ci, code.begin(), code.end());
+            ci += code.size() - 1;
+
+            stack.emplace_back(Type::UINT);
+            has_type = false;
+            break;
+        }
+
+        case Command::JMP:
+        case Command::JZ:
+        case Command::JNZ:
+        case Command::BOOL:
+            throw std::runtime_error("Sanity error, jump instructions in unlowered code.");
+
         case Command::FUN:
         case Command::FUN0:
+        case Command::FUN2:
+        case Command::FUN3:
         {
 
             if (c.closure.size() != 1)
@@ -553,10 +889,25 @@ Type infer_expr(std::vector<Command>& commands, TypeRuntime& typer, bool allow_e
             c.function = (void*)tmp.first;
             stack.emplace_back(tmp.second);
 
-            if (args.type == Type::NONE)
+            functions().rewrite(c, clo.code);
+
+            void* direct;
+            UInt nargs;
+
+            if (args.type == Type::NONE) {
                 c.cmd = Command::FUN0;
-            else
+
+            } else if (functions().get_direct(c.function, direct, nargs) &&
+                       clo.code.back().cmd == Command::TUP && clo.code.back().arg.uint == nargs) {
+
+                // The arguments are already on the stack, no need to pack them.
+                clo.code.pop_back();
+                c.function = direct;
+                c.cmd = (nargs == 2 ? Command::FUN2 : Command::FUN3);
+
+            } else {
                 c.cmd = Command::FUN;
+            }
             
             ci = commands.insert(ci, clo.code.begin(), clo.code.end());
             ci += clo.code.size();
@@ -25,14 +25,47 @@ struct Object {
         throw std::runtime_error("Object cloning not implemented");
     }
 
+    // Like 'clone', but places the copy in 'a'. Returns nullptr for objects
+    // that cannot live in an arena.
+    virtual Object* clone_in(Arena& a) const {
+        return nullptr;
+    }
+
+    // Like 'clone', but may move this object's contents into the copy and
+    // leave this object empty. Only for elements of a 'scratch()' sequence.
+    virtual Object* steal() {
+        return clone();
+    }
+
     virtual void fill(Object*) {
         throw std::runtime_error("Object construction not implemented");
     }
 
+    // Appends a byte encoding that is equal for equal objects.
+    virtual void encode(std::string&) const {
+        throw std::runtime_error("Object encoding not implemented");
+    }
+
+    // Reads back what 'encode' wrote, advancing 'p'.
+    virtual void decode(const char*& p) {
+        throw std::runtime_error("Object decoding not implemented");
+    }
+
+    // An estimate of the memory held outside of the object itself, used to
+    // keep maps within the budget set with '-m'. Must be cheap to compute.
+    virtual size_t bytes() const {
+        return 0;
+    }
+
     virtual void wrap(Object*) { throw std::runtime_error("Object sequence wrapping is not implemented"); }
     
     virtual Object* next() { throw std::runtime_error("Object 'next' operator not implemented"); }
 
+    // True if the objects returned by 'next' are overwritten on the following
+    // call and not referred to from anywhere else, so that whoever stores
+    // them can take their contents over instead of copying.
+    virtual bool scratch() const { return false; }
+
     virtual void merge_start() {}
     virtual void merge(const Object*) {}
     virtual void merge_end() {}
@@ -48,17 +81,65 @@ Object* nothing() {
     return ret;
 }
 
+template <typename T>
+void encode_atom(std::string& out, T v) {
+    out.append((const char*)&v, sizeof(v));
+}
+
+inline void encode_atom(std::string& out, ::Real v) {
+    // 0.0 and -0.0 compare equal.
+    if (v == 0)
+        v = 0;
+
+    out.append((const char*)&v, sizeof(v));
+}
+
+inline void encode_atom(std::string& out, const std::string& v) {
+    uint32_t n = v.size();
+    out.append((const char*)&n, sizeof(n));
+    out.append(v);
+}
+
+template <typename T>
+void decode_atom(const char*& p, T& v) {
+    ::memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+}
+
+inline void decode_atom(const char*& p, std::string& v) {
+    uint32_t n;
+    decode_atom(p, n);
+    v.assign(p, n);
+    p += n;
+}
+
+// Memory held by an atom outside of its own object.
+template <typename T>
+size_t heap_bytes(const T&) {
+    return 0;
+}
+
+inline size_t heap_bytes(const std::string& s) {
+    return (s.size() < 16 ? 0 : s.capacity() + 1);
+}
+
 template <typename T>
 struct Atom : public Object {
     T v;
 
     Atom(const T& i = T()) : v(i) {}
+    Atom(T&& i) : v(std::move(i)) {}
 
-    size_t hash() const { return std::hash<T>()(v); }
+    size_t hash() const { return Hash<T>()(v); }
     bool eq(Object* a) const { return v == get< Atom<T> >(a).v; }
     bool less(Object* a) const { return v < get< Atom<T> >(a).v; }
     void print() { std::cout << v; }
     Object* clone() const { return new Atom<T>(v); }
+    Object* clone_in(Arena& a) const { return a.make< Atom<T> >(v); }
+    Object* steal() { return new Atom<T>(std::move(v)); }
+    size_t bytes() const { return heap_bytes(v); }
+    void encode(std::string& out) const { encode_atom(out, v); }
+    void decode(const char*& p) { decode_atom(p, v); }
 };
 
 typedef Atom<::Int> Int;
@@ -72,9 +153,9 @@ struct ArrayAtom : public Object {
     std::vector<T> v;
 
     size_t hash() const {
-        size_t ret = 0;
+        size_t ret = hash_int(v.size());
         for (const T& t : v) {
-            ret += std::hash<T>()(t);
+            ret = hash_combine(ret, Hash<T>()(t));
         }
         return ret;
     }
@@ -111,13 +192,45 @@ struct ArrayAtom : public Object {
 
         v.clear();
 
+        bool move = seq->scratch();
+
         while (1) {
 
             Object* next = seq->next();
 
             if (!next) break;
-            
-            v.push_back(get< Atom<T> >(next).v);
+
+            if (move) {
+                v.push_back(std::move(get< Atom<T> >(next).v));
+            } else {
+                v.push_back(get< Atom<T> >(next).v);
+            }
+        }
+    }
+
+    // Long strings' own buffers are not counted, so that this stays O(1).
+    size_t bytes() const {
+        return v.capacity() * sizeof(T);
+    }
+
+    void encode(std::string& out) const {
+
+        encode_atom(out, (uint32_t)v.size());
+
+        for (const T& x : v) {
+            encode_atom(out, x);
+        }
+    }
+
+    void decode(const char*& p) {
+
+        uint32_t n;
+        decode_atom(p, n);
+
+        v.resize(n);
+
+        for (T& x : v) {
+            decode_atom(p, x);
         }
     }
 };
@@ -139,9 +252,9 @@ struct ArrayObject : public Object {
     }
     
     size_t hash() const {
-        size_t ret = 0;
+        size_t ret = hash_int(v.size());
         for (Object* t : v) {
-            ret += t->hash();
+            ret = hash_combine(ret, t->hash());
         }
         return ret;
     }
@@ -204,6 +317,7 @@ struct ArrayObject : public Object {
     Object* clone() const {
 
         ArrayObject* ret = new ArrayObject;
+        ret->v.reserve(v.size());
 
         for (const Object* s : v) {
             ret->v.push_back(s->clone());
@@ -216,15 +330,55 @@ struct ArrayObject : public Object {
 
         clear();
 
+        bool move = seq->scratch();
+
         while (1) {
 
             Object* next = seq->next();
 
             if (!next) break;
             
-            v.push_back(next->clone());
+            v.push_back(move ? next->steal() : next->clone());
+        }
+    }
+
+    // Elements are counted with a rough guess, like map values are.
+    size_t bytes() const {
+        return v.capacity() * sizeof(Object*) + v.size() * 64;
+    }
+
+    void encode(std::string& out) const {
+
+        encode_atom(out, (uint32_t)v.size());
+
+        for (const Object* x : v) {
+            x->encode(out);
+        }
+    }
+
+    // New elements are decoded into copies of the first one, so an empty
+    // array cannot be decoded into.
+    void decode(const char*& p) {
+
+        uint32_t n;
+        decode_atom(p, n);
+
+        if (n > 0 && v.empty())
+            throw std::runtime_error("Sanity error: decoding into an empty array.");
+
+        while (v.size() > n) {
+            delete v.back();
+            v.pop_back();
+        }
+
+        while (v.size() < n) {
+            v.push_back(v[0]->clone());
         }
-    }        
+
+        for (Object* x : v) {
+            x->decode(p);
+        }
+    }
 };
 
 struct Tuple : public ArrayObject {
@@ -251,6 +405,7 @@ struct Tuple : public ArrayObject {
     Object* clone() const {
 
         Tuple* ret = new Tuple;
+        ret->v.reserve(v.size());
 
         for (const Object* s : v) {
             ret->v.push_back(s->clone());
@@ -263,6 +418,29 @@ struct Tuple : public ArrayObject {
         throw std::runtime_error("Cannot construct tuples");
     }
 
+    void encode(std::string& out) const {
+        for (const Object* x : v) {
+            x->encode(out);
+        }
+    }
+
+    void decode(const char*& p) {
+        for (Object* x : v) {
+            x->decode(p);
+        }
+    }
+
+    size_t bytes() const {
+
+        size_t ret = v.size() * 32;
+
+        for (const Object* x : v) {
+            ret += x->bytes();
+        }
+
+        return ret;
+    }
+
     virtual void merge_start() {
         for (Object* o : v) {
             o->merge_start();
@@ -302,37 +480,352 @@ struct ObjectLess {
     }
 };
 
-struct MapObject : public Object {
+// Keys stored as separately allocated objects, hashed and compared with
+// virtual calls. Used for maps with tuple, array or map keys.
+struct ObjectKeys {
+
+    typedef Object* key_t;
+    typedef ObjectHash hash_t;
+    typedef ObjectEq eq_t;
+    typedef ObjectLess less_t;
+
+    static Object* obj(const key_t& k) { return k; }
+    static const key_t& probe(Object* const& k) { return k; }
+    static key_t copy(const Object* k, const key_t&, Arena&) { return k->clone(); }
+    static void drop(const key_t& k) { delete k; }
+
+    // A rough guess: a few boxed objects per key.
+    static size_t bytes(const key_t&) { return 128; }
+};
+
+// Atom keys stored inline in the map, hashed and compared directly.
+template <typename T>
+struct AtomKeys {
+
+    typedef Atom<T> key_t;
+
+    struct hash_t {
+        size_t operator()(const key_t& k) const { return Hash<T>()(k.v); }
+    };
+
+    struct eq_t {
+        bool operator()(const key_t& a, const key_t& b) const { return a.v == b.v; }
+    };
+
+    struct less_t {
+        bool operator()(const key_t& a, const key_t& b) const { return a.v < b.v; }
+    };
+
+    static Object* obj(const key_t& k) { return (Object*)&k; }
+    static const key_t& probe(Object* const& k) { return get<key_t>(k); }
+    static key_t copy(const Object*, const key_t& p, Arena&) { return p; }
+    static void drop(const key_t& k) {}
+
+    static size_t bytes(const key_t& k) { return heap_bytes(k.v); }
+};
+
+// Tuples of atoms stored flat: the key bytes are compared with one memcmp,
+// and the Tuple object handed out to readers lives in the map's arena.
+struct TupleKey {
+    const char* data;
+    size_t size;
+    Tuple* obj;
+};
+
+struct TupleKeys {
+
+    typedef TupleKey key_t;
+
+    struct hash_t {
+        size_t operator()(const key_t& k) const { return hash_bytes(k.data, k.size); }
+    };
+
+    struct eq_t {
+        bool operator()(const key_t& a, const key_t& b) const {
+            return a.size == b.size && ::memcmp(a.data, b.data, a.size) == 0;
+        }
+    };
+
+    // The flat bytes do not sort like the tuple does.
+    struct less_t {
+        bool operator()(const key_t& a, const key_t& b) const { return a.obj->less(b.obj); }
+    };
+
+    static Object* obj(const key_t& k) { return k.obj; }
+
+    // The returned key points into a buffer that is reused by the next probe.
+    static key_t probe(Object* const& k) {
+
+        static std::string buf;
+
+        buf.clear();
+
+        for (const Object* x : get<Tuple>(k).v) {
+            x->encode(buf);
+        }
+
+        return key_t{buf.data(), buf.size(), (Tuple*)k};
+    }
+
+    static key_t copy(const Object* k, const key_t& p, Arena& a) {
+
+        char* data = (char*)a.alloc(p.size, 1);
+        ::memcpy(data, p.data, p.size);
+
+        const Tuple& src = get<Tuple>(k);
+        Tuple* t = a.make<Tuple>();
+
+        t->v.reserve(src.v.size());
+
+        for (const Object* x : src.v) {
+            Object* c = x->clone_in(a);
+
+            if (c == nullptr)
+                throw std::runtime_error("Sanity error: flat tuple key with a non-atom element.");
+
+            t->v.push_back(c);
+        }
+
+        return key_t{data, p.size, t};
+    }
+
+    // The flat bytes are in the arena; strings in the Tuple hold a second copy.
+    static size_t bytes(const key_t& k) { return k.size + 32; }
+
+    static void drop(const key_t& k) {
+
+        for (Object* x : k.obj->v) {
+            x->~Object();
+        }
+
+        k.obj->v.clear();
+        k.obj->~Tuple();
+    }
+};
+
+/*
+ * Spilling maps to disk.
+ *
+ * A map that grows beyond the memory budget set with '-m' stops taking new
+ * keys. Rows for keys it already holds are still merged in memory; rows for
+ * new keys are encoded and appended to one of Spill::PARTS temporary files,
+ * chosen by the key's hash. Every file is later read back into the map on
+ * its own, and can spill again using the next bits of the hash.
+ *
+ * Only the map that is printed as the program's result can spill, since it
+ * never needs all of its keys in memory at once. Any other map that outgrows
+ * the budget is an error. (Sorting a sequence spills the same way, see
+ * funcs/sort.h.)
+ */
+
+size_t& memory_budget() {
+    static size_t ret = 0;
+    return ret;
+}
+
+Object*& spill_target() {
+    static Object* ret = nullptr;
+    return ret;
+}
+
+struct Spill {
 
-    typedef std::unordered_map<Object*, Object*, ObjectHash, ObjectEq> map_t;
+    static const size_t PARTS = 16;
+    static const unsigned int LEVELS = 64 / 4;
+
+    std::vector<FILE*> files;
+
+    // Copies of the first spilled key and value, decoded into when reading back.
+    Tuple* row;
+    std::string buf;
+
+    Spill() : row(nullptr) {}
+
+    Spill(const Spill&) = delete;
+    Spill& operator=(const Spill&) = delete;
+
+    ~Spill() {
+        close();
+    }
+
+    void close() {
+
+        for (FILE* f : files) {
+            ::fclose(f);
+        }
+
+        files.clear();
+        delete row;
+        row = nullptr;
+    }
+
+    void swap(Spill& other) {
+        files.swap(other.files);
+        std::swap(row, other.row);
+    }
+
+    void write(const Object* key, const Object* val, size_t hash, unsigned int level) {
+
+        if (level >= LEVELS)
+            throw std::runtime_error("A map still outgrows the memory budget after partitioning it on disk.");
+
+        if (files.empty()) {
+
+            for (size_t i = 0; i < PARTS; ++i) {
+
+                FILE* f = ::tmpfile();
+
+                if (f == nullptr)
+                    throw std::runtime_error("Could not create a temporary file to spill a map to.");
+
+                files.push_back(f);
+            }
+
+            row = new Tuple;
+            row->v.push_back(key->clone());
+            row->v.push_back(val->clone());
+        }
+
+        buf.clear();
+        key->encode(buf);
+        val->encode(buf);
+
+        uint32_t n = buf.size();
+        // From the top, since the table itself uses the low bits.
+        FILE* f = files[(hash >> (60 - level * 4)) % PARTS];
+
+        if (::fwrite(&n, sizeof(n), 1, f) != 1 || ::fwrite(buf.data(), 1, n, f) != n)
+            throw std::runtime_error("Could not write spilled map data.");
+    }
+};
+
+// Reads the (key, value) rows of one spill file back as a sequence.
+struct SpillReader : public Object {
+
+    FILE* file;
+    Tuple* row;
+    std::string buf;
+
+    SpillReader(FILE* f, Tuple* r) : file(f), row(r) {
+        ::rewind(file);
+    }
+
+    Object* next() {
+
+        uint32_t n;
+
+        if (::fread(&n, sizeof(n), 1, file) != 1)
+            return nullptr;
+
+        buf.resize(n);
+
+        if (::fread(&buf[0], 1, n, file) != n)
+            throw std::runtime_error("Could not read spilled map data.");
+
+        const char* p = buf.data();
+        row->v[0]->decode(p);
+        row->v[1]->decode(p);
+
+        return row;
+    }
+};
+
+template <typename Keys>
+struct MapBase : public Object {
+
+    typedef Keys keys_t;
+    typedef typename Keys::key_t key_t;
+    typedef FlatMap<key_t, Object*, typename Keys::hash_t, typename Keys::eq_t> map_t;
     map_t v;
 
-    ~MapObject() {
+    // Values are cloned into the arena when their type allows it, and then
+    // released all at once instead of deleted one by one.
+    Arena arena;
+    bool in_arena;
+
+    // Memory used by keys outside of the table and the arena, and by values
+    // outside of their own objects.
+    size_t key_bytes;
+    size_t val_bytes;
+
+    Spill spill;
+    unsigned int spill_level;
+    bool spilling;
+
+    MapBase() : in_arena(false), key_bytes(0), val_bytes(0), spill_level(0), spilling(false) {}
+
+    ~MapBase() {
         clear();
     }
 
     void clear() {
 
         for (const auto& x : v) {
-            delete x.first;
-            delete x.second;
+            Keys::drop(x.first);
+
+            if (in_arena) {
+                x.second->~Object();
+            } else {
+                delete x.second;
+            }
         }
 
         v.clear();
+        arena.reset();
+        in_arena = false;
+        key_bytes = 0;
+        val_bytes = 0;
+
+        spill.close();
+        spilling = false;
     }
-    
+
+    // An estimate of the memory held by the map.
+    size_t bytes() const {
+        return v.bytes() + arena.size() + key_bytes + val_bytes + (in_arena ? 0 : v.size() * 64);
+    }
+
+    void check_budget() {
+
+        size_t budget = memory_budget();
+
+        if (budget == 0 || bytes() <= budget)
+            return;
+
+        if (spill_target() != this)
+            throw std::runtime_error("A map outgrew the memory budget set with '-m'; "
+                                     "only a map printed as the result can be spilled to disk.");
+
+        spilling = true;
+    }
+
+    static Object* key(const typename map_t::value_type& x) {
+        return Keys::obj(x.first);
+    }
+
+    // Returns the value stored under 'k', or nullptr.
+    Object* find(Object* k) const {
+
+        auto i = v.find(Keys::probe(k));
+
+        if (i == nullptr)
+            return nullptr;
+
+        return i->second;
+    }
+
     size_t hash() const {
-        size_t ret = 0;
+        size_t ret = hash_int(v.size());
         for (const auto& t : v) {
-            ret += t.first->hash();
-            ret += t.second->hash();
+            ret = hash_combine(ret, key(t)->hash());
+            ret = hash_combine(ret, t.second->hash());
         }
         return ret;
     }
 
     bool eq(Object* a) const {
 
-        const map_t& b = get<MapObject>(a).v;
+        const map_t& b = get< MapBase<Keys> >(a).v;
 
         if (v.size() != b.size())
             return false;
@@ -343,7 +836,7 @@ struct MapObject : public Object {
 
         while (i != ie) {
 
-            if (!(i->first->eq(j->first)) ||
+            if (!(key(*i)->eq(key(*j))) ||
                 !(i->second->eq(j->second))) {
 
                 return false;
@@ -357,7 +850,7 @@ struct MapObject : public Object {
     }
 
     bool less(Object* a) const {
-        const map_t& other = get<MapObject>(a).v;
+        const map_t& other = get< MapBase<Keys> >(a).v;
 
         auto ai = v.begin();
         auto ae = v.end();
@@ -369,10 +862,10 @@ struct MapObject : public Object {
             if (ai == ae || bi == be)
                 return (bi != be);
 
-            if (ai->first->less(bi->first))
+            if (key(*ai)->less(key(*bi)))
                 return true;
 
-            if (bi->first->less(ai->first))
+            if (key(*bi)->less(key(*ai)))
                 return false;
 
             if (ai->second->less(bi->second))
@@ -388,8 +881,8 @@ struct MapObject : public Object {
         return false;
     }
 
-    void print() {
-        bool first = true;
+    void print_entries(bool& first) {
+
         for (const auto& x : v) {
             if (first) {
                 first = false;
@@ -397,25 +890,93 @@ struct MapObject : public Object {
                 std::cout << std::endl;
             }
 
-            x.first->print();
+            key(x)->print();
             std::cout << "\t";
             x.second->print();
         }
     }
 
+    // Keys that were spilled to disk are printed one file at a time.
+    void print_spilled(bool& first) {
+
+        print_entries(first);
+
+        if (spill.files.empty())
+            return;
+
+        Spill parts;
+        parts.swap(spill);
+
+        unsigned int level = spill_level;
+
+        for (FILE* f : parts.files) {
+
+            SpillReader reader(f, parts.row);
+
+            spill_level = level + 1;
+            fill(&reader);
+
+            print_spilled(first);
+        }
+
+        spill_level = level;
+    }
+
+    void print() {
+        bool first = true;
+        print_spilled(first);
+    }
+
     Object* clone() const {
 
-        MapObject* ret = new MapObject;
+        MapBase<Keys>* ret = new MapBase<Keys>;
 
         for (const auto& x : v) {
-            Object* k = x.first->clone();
-            Object* v = x.second->clone();
-            ret->v[k] = v;
+            ret->v.emplace(Keys::copy(key(x), x.first, ret->arena), x.second->clone());
         }
 
         return ret;
     }
 
+    // All values in a map share one type, so the first one decides whether
+    // the map's values live in the arena.
+    Object* clone_value(const Object* val) {
+
+        if (v.size() == 1)
+            in_arena = true;
+
+        if (in_arena) {
+            Object* ret = val->clone_in(arena);
+
+            if (ret != nullptr)
+                return ret;
+
+            if (v.size() > 1)
+                throw std::runtime_error("Sanity error: map values of mixed kinds.");
+
+            in_arena = false;
+        }
+
+        return val->clone();
+    }
+
+    // Values like sort() or distinct() grow as rows are merged into them.
+    void merge_value(Object* x, const Object* val) {
+
+        size_t before = x->bytes();
+
+        x->merge(val);
+
+        size_t after = x->bytes();
+
+        if (after != before) {
+            val_bytes = val_bytes + after - before;
+
+            if (after > before)
+                check_budget();
+        }
+    }
+
     void fill(Object* seq) {
 
         clear();
@@ -431,16 +992,34 @@ struct MapObject : public Object {
             Object* key = tup.v[0];
             Object* val = tup.v[1];
 
-            auto i  = v.find(key);
-            
-            if (i != v.end()) {
-                i->second->merge(val);
+            const key_t& k = Keys::probe(key);
+
+            if (spilling) {
+
+                auto i = v.find(k);
+
+                if (i != nullptr) {
+                    merge_value(i->second, val);
+                } else {
+                    spill.write(key, val, v.hasher(k), spill_level);
+                }
+
+                continue;
+            }
+
+            auto i = v.find_or_insert(k, [this,key,&k]() { return Keys::copy(key, k, arena); });
+
+            if (!i.second) {
+                merge_value(i.first->second, val);
 
             } else {
-                key = key->clone();
-                val = val->clone();
+                val = clone_value(val);
                 val->merge_start();
-                v[key] = val;
+                i.first->second = val;
+
+                key_bytes += Keys::bytes(i.first->first);
+                val_bytes += val->bytes();
+                check_budget();
             }
         }
 
@@ -450,6 +1029,51 @@ struct MapObject : public Object {
     }
 };
 
+typedef MapBase<ObjectKeys> MapObject;
+typedef MapBase<TupleKeys> MapTuple;
+
+// Tuples whose elements are all atoms can be used as flat map keys.
+bool flat_tuple(const Type& t) {
+
+    if (t.type != Type::TUP || !t.tuple || t.tuple->empty())
+        return false;
+
+    for (const Type& x : *t.tuple) {
+        if (x.type != Type::ATOM)
+            return false;
+    }
+
+    return true;
+}
+
+template <typename T>
+using MapAtom = MapBase< AtomKeys<T> >;
+
+// Maps with atom or flat tuple keys store their keys inline. Returns
+// F<M>::doit for the map type M that 'make' creates for the key type 'key'.
+template <typename R, template <typename> class F>
+R map_pick(const Type& key) {
+
+    if (key.type == Type::ATOM) {
+
+        switch (key.atom) {
+        case Type::INT:
+            return F< MapAtom<::Int> >::doit;
+        case Type::UINT:
+            return F< MapAtom<::UInt> >::doit;
+        case Type::REAL:
+            return F< MapAtom<::Real> >::doit;
+        case Type::STRING:
+            return F< MapAtom<std::string> >::doit;
+        }
+    }
+
+    if (flat_tuple(key))
+        return F<MapTuple>::doit;
+
+    return F<MapObject>::doit;
+}
+
 
 struct SeqBase : public Object {
 
@@ -537,6 +1161,8 @@ struct SeqArrayAtom : public SeqBase {
 
         return holder;
     }
+
+    bool scratch() const { return true; }
 };
 
 struct SeqArrayObject : public SeqBase {
@@ -564,20 +1190,21 @@ struct SeqArrayObject : public SeqBase {
     }
 };
 
-struct SeqMapObject : public SeqBase {
+template <typename M>
+struct SeqMap : public SeqBase {
 
-    MapObject* map;
+    M* map;
     Tuple* holder;
-    typename MapObject::map_t::const_iterator b;
-    typename MapObject::map_t::const_iterator e;
+    typename M::map_t::const_iterator b;
+    typename M::map_t::const_iterator e;
 
-    SeqMapObject() {
+    SeqMap() {
         holder = new Tuple;
         holder->v.resize(2);
     }
     
     void wrap(Object* a) {
-        map = (MapObject*)a;
+        map = (M*)a;
         b = map->v.begin();
         e = map->v.end();
     }
@@ -588,7 +1215,7 @@ struct SeqMapObject : public SeqBase {
             return nullptr;
         }
 
-        holder->v[0] = b->first;
+        holder->v[0] = M::key(*b);
         holder->v[1] = b->second;
         ++b;
 
@@ -596,6 +1223,13 @@ struct SeqMapObject : public SeqBase {
     }
 };
 
+template <typename M>
+struct make_seq_map {
+    static Object* doit() {
+        return new SeqMap<M>;
+    }
+};
+
 struct SeqGenerator : public SeqBase {
 
     typedef std::function<Object*()> iterator_t;
@@ -665,6 +1299,25 @@ Object* make(const Type& t, U&&... u) {
 
     } else if (t.type == Type::MAP) {
 
+        const Type& k = (*t.tuple)[0];
+
+        if (k.type == Type::ATOM) {
+
+            switch (k.atom) {
+            case Type::INT:
+                return new MapAtom<::Int>(std::forward<U>(u)...);
+            case Type::UINT:
+                return new MapAtom<::UInt>(std::forward<U>(u)...);
+            case Type::REAL:
+                return new MapAtom<::Real>(std::forward<U>(u)...);
+            case Type::STRING:
+                return new MapAtom<std::string>(std::forward<U>(u)...);
+            }
+        }
+
+        if (flat_tuple(k))
+            return new MapTuple(std::forward<U>(u)...);
+
         return new MapObject(std::forward<U>(u)...);
 
     } else if (t.type == Type::SEQ) {
@@ -684,7 +1337,7 @@ Object* make_seq_from(const Type& s) {
 
     } else if (s.type == Type::MAP) {
 
-        return new SeqMapObject;
+        return map_pick< Object*(*)(),make_seq_map >((*s.tuple)[0])();
 
     } else if (s.type == Type::ARR) {
 
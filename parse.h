@@ -70,8 +70,10 @@ struct ParseStack {
         for (const auto& i : c) {
             std::cout << " " << std::string(level*2, ' ') << Command::print(i.cmd);
 
-            if (i.cmd == Command::VAL || i.cmd == Command::VAR || i.cmd == Command::VAW || i.cmd == Command::FUN ||
-                i.cmd == Command::TUP || (print_types && i.cmd == Command::GEN)) {
+            if (i.cmd == Command::VAL || i.cmd == Command::VAR || i.cmd == Command::VAW ||
+                i.cmd == Command::FUN || i.cmd == Command::FUN2 || i.cmd == Command::FUN3 ||
+                i.cmd == Command::TUP || i.cmd == Command::JMP || i.cmd == Command::JZ || i.cmd == Command::JNZ ||
+                (print_types && i.cmd == Command::GEN)) {
 
                 std::cout << " " << Atom::print(i.arg);
             }
@@ -210,13 +212,24 @@ Type parse(I beg, I end, TypeRuntime& typer, std::vector<Command>& commands, uns
         ~x_expr & x_ws &
         axe::r_lit(')') >> y_close_fun;
 
+    auto y_close_if = axe::e_ref([&](I b, I e) { stack.close(Command::IF); });
+
+    auto x_if =
+        (axe::r_lit("if") & x_ws & axe::r_lit('(')) &
+        (((axe::r_empty() >> y_mark) & (x_expr_atom >> y_close_if) & axe::r_lit(',') &
+          (axe::r_empty() >> y_mark) & (x_expr_atom >> y_close_arg) & axe::r_lit(',') &
+          (axe::r_empty() >> y_mark) & (x_expr_atom >> y_close_arg) & x_ws & axe::r_lit(')')) |
+         axe::r_fail([](I b, I e) {
+                 throw std::runtime_error("Syntax error: 'if' expects three arguments: \"" + std::string(b, e) + "\"");
+             }));
+
     auto y_var_read = axe::e_ref([&](I b, I e) { stack.push(Command::VAR, make_string(b, e)); });
     
     auto x_var_read = x_var >> y_var_read;
 
     auto x_expr_bottom =
         x_ws &
-        (x_literal | x_funcall | x_var_read | x_array | x_map | x_generator | 
+        (x_literal | x_if | x_funcall | x_var_read | x_array | x_map | x_generator | 
          (axe::r_lit('(') & x_expr_atom & axe::r_lit(')'))) &
         x_ws;
 
@@ -271,8 +284,8 @@ Type parse(I beg, I end, TypeRuntime& typer, std::vector<Command>& commands, uns
     auto y_expr_xor = axe::e_ref([&](I b, I e) { stack.push(Command::XOR); });
 
     auto x_expr_bit =
-        x_expr_add & *((axe::r_lit('&') & x_expr_add) >> y_expr_and |
-                       (axe::r_lit('|') & x_expr_add) >> y_expr_or |
+        x_expr_add & *(((axe::r_lit('&') - axe::r_lit("&&")) & x_expr_add) >> y_expr_and |
+                       ((axe::r_lit('|') - axe::r_lit("||")) & x_expr_add) >> y_expr_or |
                        (axe::r_lit('^') & x_expr_add) >> y_expr_xor);
 
     auto y_expr_eq  = axe::e_ref([&](I b, I e) { stack.push(Command::EQ); });
@@ -290,7 +303,14 @@ Type parse(I beg, I end, TypeRuntime& typer, std::vector<Command>& commands, uns
                        (axe::r_lit("<=") & x_expr_bit) >> y_expr_lte |
                        (axe::r_lit(">=") & x_expr_bit) >> y_expr_gte);
 
-    x_expr_atom = x_expr_eq;
+    auto y_close_land = axe::e_ref([&](I b, I e) { stack.close(Command::LAND); });
+    auto y_close_lor = axe::e_ref([&](I b, I e) { stack.close(Command::LOR); });
+
+    auto x_expr_logic =
+        x_expr_eq & *((axe::r_lit("&&") >> y_mark & x_expr_eq) >> y_close_land |
+                      (axe::r_lit("||") >> y_mark & x_expr_eq) >> y_close_lor);
+
+    x_expr_atom = x_expr_logic;
 
     auto y_expr_assign_var = axe::e_ref([&](I b, I e) { stack.names.emplace_back(make_string(b, e)); });
     auto y_expr_assign = axe::e_ref([&](I b, I e) { stack.push(Command::VAW, stack.names.back());
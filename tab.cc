@@ -16,6 +16,33 @@ std::istream& file_or_stdin(const std::string& file) {
     return ret;
 }        
 
+// Parses a byte count with an optional K, M or G suffix.
+size_t parse_bytes(const std::string& s) {
+
+    size_t end = 0;
+    size_t ret;
+
+    try {
+        ret = std::stoull(s, &end);
+    } catch (std::exception& e) {
+        throw std::runtime_error("Invalid byte count: " + s);
+    }
+
+    std::string suffix = s.substr(end);
+
+    if (suffix == "K" || suffix == "k") {
+        ret <<= 10;
+    } else if (suffix == "M" || suffix == "m") {
+        ret <<= 20;
+    } else if (suffix == "G" || suffix == "g") {
+        ret <<= 30;
+    } else if (!suffix.empty()) {
+        throw std::runtime_error("Invalid byte count: " + s);
+    }
+
+    return ret;
+}
+
 int main(int argc, char** argv) {
 
     try {
@@ -58,9 +85,17 @@ int main(int argc, char** argv) {
                 ++i;
                 infile = argv[i];
 
+            } else if (arg == "-m") {
+
+                if (i == argc - 1)
+                    throw std::runtime_error("The '-m' command line argument expects a byte count argument.");
+
+                ++i;
+                obj::memory_budget() = parse_bytes(argv[i]);
+
             } else if (arg == "-h") {
 
-                std::cout << "Usage: tab [-i inputdata_file] [-f expression_file] [-v|-vv|-vvv] <expressions...>"
+                std::cout << "Usage: tab [-i inputdata_file] [-f expression_file] [-m memory_bytes] [-v|-vv|-vvv] <expressions...>"
                           << std::endl;
                 return 1;
                 
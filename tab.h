@@ -40,6 +40,9 @@ struct bm {
 #include "command.h"
 #include "infer.h"
 #include "parse.h"
+#include "hash.h"
+#include "arena.h"
+#include "flatmap.h"
 #include "object.h"
 #include "funcs.h"
 #include "exec.h"
@@ -3,9 +3,23 @@ import subprocess
 import glob
 
 def run(filename,arg,expected):
-    print(">>>", arg.replace('\n',' '))
-    out = subprocess.check_output(["../tab", "-i", "../LICENSE.txt", arg])
-    out = out.decode('ascii')
+    # A first line starting with '-' holds extra command line flags.
+    flags = []
+    if arg.startswith('-'):
+        line, arg = arg.split('\n', 1)
+        flags = line.split()
+    print(">>>", ' '.join(flags), arg.replace('\n',' '))
+    p = subprocess.run(["../tab", "-i", "../LICENSE.txt"] + flags + [arg],
+                       stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    # An expected output starting with 'ERROR:' is checked against stderr.
+    if expected.startswith('ERROR:'):
+        out = p.stderr.decode('ascii')
+        if p.returncode == 0 or not out:
+            raise Exception("Test did not fail: " + filename + ", " + arg)
+    elif p.returncode != 0:
+        raise Exception("Test failed for: " + filename + ", " + arg + ": " + p.stderr.decode('ascii'))
+    else:
+        out = p.stdout.decode('ascii')
     if not expected.startswith(out):
         raise Exception("Test failed for: " + filename + ", " + arg)
 